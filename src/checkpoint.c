@@ -0,0 +1,242 @@
+#include "xssmap.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define JOURNAL_MAGIC "xsmjrnl3"
+
+typedef struct {
+    char magic[8];
+    uint64_t payload_digest;
+    uint64_t consumed;
+    uint64_t windows_done;
+    uint64_t clearing;
+    uint32_t window;
+    uint32_t payload_count;
+} journal_header_t;
+
+struct journal {
+    int fd;
+    void *map;
+    size_t map_size;
+    journal_header_t *header;
+    atomic_uint_least64_t *bits;
+    size_t words;
+    FILE *log;
+    long resumed_tasks;
+    int restored;
+};
+
+static uint64_t payload_digest(const config_t *config) {
+    uint64_t digest = (uint64_t)config->payload_count;
+    for (int p = 0; p < config->payload_count; p++) {
+        digest = digest * 0x100000001b3ULL ^ hash64(config->payloads[p], strlen(config->payloads[p]));
+    }
+    return digest;
+}
+
+static char *log_path(const char *path) {
+    char *log = malloc(strlen(path) + 5);
+    sprintf(log, "%s.log", path);
+    return log;
+}
+
+static void clear_window(journal_t *journal, size_t bit, size_t end) {
+    while (bit < end) {
+        if (bit % 64 == 0 && bit + 64 <= end) {
+            atomic_store(&journal->bits[bit / 64], 0);
+            bit += 64;
+        } else {
+            atomic_fetch_and(&journal->bits[bit / 64], ~(1ULL << (bit % 64)));
+            bit++;
+        }
+    }
+    journal->header->clearing = 0;
+    msync(journal->map, journal->map_size, MS_SYNC);
+}
+
+static void fail(const char *what, const char *path) {
+    fprintf(stderr, "\033[91m[✗]\033[0m %s %s\n", what, path);
+}
+
+bool checkpoint_open(config_t *config) {
+    if (!config->checkpoint_file) return true;
+
+    const char *path = config->checkpoint_file;
+    int fd = open(path, config->resume ? O_RDWR : O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 && !config->resume && errno == EEXIST) {
+        fail("checkpoint exists, pass --resume to continue it or remove", path);
+        return false;
+    }
+    if (fd < 0) {
+        fail(config->resume ? "no checkpoint to resume at" : "failed to create checkpoint", path);
+        return false;
+    }
+
+    journal_header_t header;
+    uint64_t digest = payload_digest(config);
+    if (config->resume) {
+        if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+            memcmp(header.magic, JOURNAL_MAGIC, 8) != 0) {
+            fail("not a checkpoint journal:", path);
+            close(fd);
+            return false;
+        }
+        if (header.payload_digest != digest || header.payload_count != (uint32_t)config->payload_count) {
+            fail("cannot resume, the payload list changed since", path);
+            close(fd);
+            return false;
+        }
+        config->url_window = (int)header.window;
+    } else {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, JOURNAL_MAGIC, 8);
+        header.payload_digest = digest;
+        header.window = (uint32_t)config->url_window;
+        header.payload_count = (uint32_t)config->payload_count;
+    }
+
+    size_t words = ((size_t)URL_WINDOWS * header.window * header.payload_count + 63) / 64;
+    size_t map_size = sizeof(journal_header_t) + words * sizeof(uint64_t);
+    if (!config->resume && (pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+                            ftruncate(fd, map_size) != 0)) {
+        fail("failed to size checkpoint", path);
+        close(fd);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < map_size) {
+        fail("checkpoint journal is truncated:", path);
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        fail("failed to map checkpoint", path);
+        close(fd);
+        return false;
+    }
+
+    char *log = log_path(path);
+    FILE *f = fopen(log, config->resume ? "a+" : "w+");
+    free(log);
+    if (!f) {
+        fail("failed to open checkpoint log for", path);
+        munmap(map, map_size);
+        close(fd);
+        return false;
+    }
+
+    journal_t *journal = calloc(1, sizeof(journal_t));
+    journal->fd = fd;
+    journal->map = map;
+    journal->map_size = map_size;
+    journal->header = (journal_header_t *)map;
+    journal->bits = (atomic_uint_least64_t *)((char *)map + sizeof(journal_header_t));
+    journal->words = words;
+    journal->log = f;
+    if (journal->header->clearing) {
+        size_t base = (size_t)(journal->header->clearing - 1);
+        clear_window(journal, base * header.payload_count, (base + header.window) * header.payload_count);
+    }
+    for (size_t w = 0; config->resume && w < words; w++) {
+        journal->resumed_tasks += __builtin_popcountll(atomic_load(&journal->bits[w]));
+    }
+    config->journal = journal;
+    return true;
+}
+
+long checkpoint_consumed(const config_t *config) {
+    return config->journal ? (long)config->journal->header->consumed : 0;
+}
+
+long checkpoint_windows(const config_t *config) {
+    return config->journal ? (long)config->journal->header->windows_done : 0;
+}
+
+void checkpoint_restore(config_t *config, scan_result_t *result) {
+    journal_t *journal = config->journal;
+    if (!journal || !config->resume) return;
+
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t read;
+    rewind(journal->log);
+    while ((read = getline(&line, &cap, journal->log)) > 0) {
+        size_t len = strcspn(line, "\r\n");
+        if (len == 0) continue;
+        line[len] = '\0';
+
+        char *url = malloc(len + 1);
+        if (finding_url(line, url, len + 1)) {
+            writer_finding(config, url, strdup(line), -1, -1, true);
+            result->total_found++;
+            journal->restored++;
+        }
+        free(url);
+    }
+    free(line);
+    fseek(journal->log, 0, SEEK_END);
+
+    printf("\033[36m[i]\033[0m resuming: %ld URLs done, %ld tasks done in open windows, %d findings restored\n\n",
+           (long)journal->header->consumed, journal->resumed_tasks, journal->restored);
+}
+
+static size_t task_bit(const config_t *config, int url_idx, int payload_idx) {
+    int origin = config->url_origin ? config->url_origin[url_idx] : url_idx;
+    return (size_t)origin * config->payload_count + payload_idx;
+}
+
+bool checkpoint_done(const config_t *config, int url_idx, int payload_idx) {
+    if (!config->journal) return false;
+
+    size_t bit = task_bit(config, url_idx, payload_idx);
+    uint64_t word = atomic_load_explicit(&config->journal->bits[bit / 64], memory_order_relaxed);
+    return (word >> (bit % 64)) & 1;
+}
+
+void checkpoint_mark(config_t *config, int url_idx, int payload_idx) {
+    if (!config->journal) return;
+
+    size_t bit = task_bit(config, url_idx, payload_idx);
+    atomic_fetch_or_explicit(&config->journal->bits[bit / 64], 1ULL << (bit % 64), memory_order_relaxed);
+}
+
+void checkpoint_skip(config_t *config, int url_idx, int payload_idx, int count) {
+    for (int i = 0; i < count; i++) checkpoint_mark(config, url_idx, payload_idx + i);
+}
+
+void checkpoint_log(config_t *config, const char *record) {
+    if (!config->journal || !record) return;
+
+    fprintf(config->journal->log, "%s\n", record);
+    fflush(config->journal->log);
+}
+
+void checkpoint_window_done(config_t *config, const url_window_t *window) {
+    journal_t *journal = config->journal;
+    if (!journal) return;
+
+    journal->header->consumed += window->read;
+    journal->header->windows_done++;
+    journal->header->clearing = (uint64_t)window->base + 1;
+    msync(journal->map, journal->map_size, MS_SYNC);
+
+    clear_window(journal, (size_t)window->base * config->payload_count,
+                 (size_t)(window->base + config->url_window) * config->payload_count);
+}
+
+void checkpoint_close(config_t *config) {
+    journal_t *journal = config->journal;
+    if (!journal) return;
+
+    msync(journal->map, journal->map_size, MS_SYNC);
+    munmap(journal->map, journal->map_size);
+    close(journal->fd);
+    fclose(journal->log);
+    free(journal);
+    config->journal = NULL;
+}
@@ -0,0 +1,159 @@
+#include "xssmap.h"
+#include <strings.h>
+#include <ctype.h>
+
+const char *probe_tokens[PROBE_TOKENS] = {"<", ">", "\"", "'", "`", "javascript:"};
+
+static const char **technique_gates[] = {
+    popup_functions, script_starters, uri_protocols, svg_tags, math_tags, iframe_tags, template_markers,
+    mutation_patterns, csp_patterns, clobber_markers, injection_tags, breakout_sequences, NULL
+};
+
+typedef enum {
+    BREAK_NONE,
+    BREAK_DOUBLE,
+    BREAK_SINGLE,
+    BREAK_BACKTICK,
+    BREAK_SCRIPT,
+    BREAK_COMMENT,
+    BREAK_TAG,
+} payload_breakout_t;
+
+static bool has_token(const char *payload, const char *token) {
+    return ci_find(payload, strlen(payload), token, strlen(token)) != NULL;
+}
+
+static unsigned payload_needs(const char *payload) {
+    unsigned needs = 0;
+    for (int t = 0; t < PROBE_TOKENS; t++) {
+        if (has_token(payload, probe_tokens[t])) needs |= 1u << t;
+    }
+    return needs;
+}
+
+static uint64_t event_handler(const char *payload) {
+    for (const char *p = payload; *p; p++) {
+        if (tolower((unsigned char)p[0]) != 'o' || tolower((unsigned char)p[1]) != 'n') continue;
+        if (p > payload && isalnum((unsigned char)p[-1])) continue;
+
+        const char *end = p + 2;
+        while (isalpha((unsigned char)*end)) end++;
+        while (isspace((unsigned char)*end)) end++;
+        if (end - p > 2 && *end == '=') {
+            char name[32];
+            size_t len = 0;
+            for (const char *c = p; isalpha((unsigned char)*c) && len < sizeof(name); c++) {
+                name[len++] = tolower((unsigned char)*c);
+            }
+            return hash64(name, len);
+        }
+    }
+    return 0;
+}
+
+static unsigned payload_gates(const char *payload) {
+    unsigned gates = 0;
+    for (int g = 0; technique_gates[g]; g++) {
+        for (int i = 0; technique_gates[g][i]; i++) {
+            if (has_token(payload, technique_gates[g][i])) {
+                gates |= 1u << g;
+                break;
+            }
+        }
+    }
+    return gates;
+}
+
+static payload_breakout_t payload_breakout(const char *payload) {
+    while (isspace((unsigned char)*payload)) payload++;
+    if (strncasecmp(payload, "</script", 8) == 0) return BREAK_SCRIPT;
+    if (strncmp(payload, "-->", 3) == 0) return BREAK_COMMENT;
+    if (strncmp(payload, "</", 2) == 0 || payload[0] == '>') return BREAK_TAG;
+    if (payload[0] == '"') return BREAK_DOUBLE;
+    if (payload[0] == '\'') return BREAK_SINGLE;
+    if (payload[0] == '`') return BREAK_BACKTICK;
+    return BREAK_NONE;
+}
+
+static uint64_t payload_class_key(const char *payload, unsigned needs) {
+    uint64_t handler = event_handler(payload);
+    uint64_t key = needs;
+    key |= (uint64_t)payload_gates(payload) << 8;
+    key |= (uint64_t)payload_breakout(payload) << 20;
+    key |= (handler & 0xffffffffULL) << 24;
+    return key;
+}
+
+void payload_classes_init(config_t *config) {
+    size_t slots = 16;
+    while (slots < (size_t)config->payload_count * 2) slots *= 2;
+
+    uint64_t *keys = calloc(slots, sizeof(uint64_t));
+    int *ids = malloc(slots * sizeof(int));
+    bool *used = calloc(slots, sizeof(bool));
+
+    config->payload_needs = malloc(config->payload_count * sizeof(unsigned));
+    config->payload_class = malloc(config->payload_count * sizeof(int));
+    config->class_count = 0;
+
+    for (int p = 0; p < config->payload_count; p++) {
+        config->payload_needs[p] = payload_needs(config->payloads[p]);
+        uint64_t key = payload_class_key(config->payloads[p], config->payload_needs[p]);
+
+        size_t slot = hash64(&key, sizeof(key)) & (slots - 1);
+        while (used[slot] && keys[slot] != key) slot = (slot + 1) & (slots - 1);
+        if (!used[slot]) {
+            used[slot] = true;
+            keys[slot] = key;
+            ids[slot] = config->class_count++;
+        }
+        config->payload_class[p] = ids[slot];
+    }
+
+    free(keys);
+    free(ids);
+    free(used);
+}
+
+void class_state_init(config_t *config) {
+    free(config->class_state);
+    config->class_state = NULL;
+    if (!config->classes) return;
+
+    config->class_state = calloc((size_t)config->url_slots * config->class_count, sizeof(atomic_uchar));
+}
+
+void class_state_reset(config_t *config, const url_window_t *window) {
+    if (!config->class_state) return;
+
+    size_t first = (size_t)window->base * config->class_count;
+    size_t last = (size_t)(window->base + window->count) * config->class_count;
+    for (size_t idx = first; idx < last; idx++) {
+        atomic_store_explicit(&config->class_state[idx], CLASS_OPEN, memory_order_relaxed);
+    }
+}
+
+bool class_settled(const config_t *config, int url_idx, int payload_idx) {
+    if (!config->class_state) return false;
+
+    size_t idx = (size_t)url_idx * config->class_count + config->payload_class[payload_idx];
+    return atomic_load_explicit(&config->class_state[idx], memory_order_relaxed) >= CLASS_BLOCKED;
+}
+
+void class_record(config_t *config, int url_idx, int payload_idx, bool found, long status) {
+    if (!config->class_state) return;
+
+    size_t idx = (size_t)url_idx * config->class_count + config->payload_class[payload_idx];
+    if (found) {
+        atomic_store_explicit(&config->class_state[idx], CLASS_CONFIRMED, memory_order_relaxed);
+        return;
+    }
+
+    bool blocked = status == 403 || status == 406;
+    unsigned char strikes = atomic_load_explicit(&config->class_state[idx], memory_order_relaxed);
+    while (strikes < CLASS_BLOCKED) {
+        unsigned char next = blocked ? strikes + 1 : CLASS_OPEN;
+        if (next == strikes) break;
+        if (atomic_compare_exchange_weak(&config->class_state[idx], &strikes, next)) break;
+    }
+}
@@ -0,0 +1,283 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "xssmap.h"
+#include <sched.h>
+#include <unistd.h>
+
+struct detect_inbox {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    detect_job_t *head;
+    detect_job_t *tail;
+    int pending;
+};
+
+struct detect_pool {
+    config_t *config;
+    pthread_t *threads;
+    int workers;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    detect_job_t **ring;
+    int head;
+    int count;
+    bool stopping;
+    long jobs;
+    long depth_sum;
+    int depth_max;
+    long stalls;
+};
+
+static void deliver(detect_job_t *job) {
+    detect_inbox_t *inbox = job->inbox;
+    job->next = NULL;
+
+    pthread_mutex_lock(&inbox->lock);
+    if (inbox->tail) {
+        inbox->tail->next = job;
+    } else {
+        inbox->head = job;
+    }
+    inbox->tail = job;
+    pthread_cond_signal(&inbox->ready);
+    pthread_mutex_unlock(&inbox->lock);
+}
+
+static void *detect_worker(void *arg) {
+    detect_pool_t *pool = (detect_pool_t *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->count == 0 && !pool->stopping) {
+            pthread_cond_wait(&pool->not_empty, &pool->lock);
+        }
+        if (pool->count == 0) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        detect_job_t *job = pool->ring[pool->head];
+        pool->head = (pool->head + 1) % DETECT_QUEUE_DEPTH;
+        pool->count--;
+        pthread_cond_signal(&pool->not_full);
+        pthread_mutex_unlock(&pool->lock);
+
+        scan_detect(pool->config, job);
+        deliver(job);
+    }
+    return NULL;
+}
+
+static int allowed_cpus(int *cpus, int max) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return 0;
+
+    int count = 0;
+    for (int c = 0; c < CPU_SETSIZE && count < max; c++) {
+        if (CPU_ISSET(c, &set)) cpus[count++] = c;
+    }
+    return count;
+}
+
+static bool pin_to_cpu(pthread_t thread, int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+int detect_default_threads(void) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return (int)sysconf(_SC_NPROCESSORS_ONLN);
+    return CPU_COUNT(&set);
+}
+
+void detect_start(config_t *config) {
+    if (config->detect_threads <= 0) return;
+
+    detect_pool_t *pool = calloc(1, sizeof(detect_pool_t));
+    pool->config = config;
+    pool->ring = malloc(DETECT_QUEUE_DEPTH * sizeof(detect_job_t *));
+    pool->threads = malloc(config->detect_threads * sizeof(pthread_t));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->not_empty, NULL);
+    pthread_cond_init(&pool->not_full, NULL);
+
+    int cpus[CPU_SETSIZE];
+    int cpu_count = allowed_cpus(cpus, CPU_SETSIZE);
+    int unpinned = 0;
+    for (int w = 0; w < config->detect_threads; w++) {
+        if (pthread_create(&pool->threads[w], NULL, detect_worker, pool) != 0) break;
+        if (cpu_count > 1 && !pin_to_cpu(pool->threads[w], cpus[w % cpu_count])) unpinned++;
+        pool->workers++;
+    }
+    if (unpinned > 0) {
+        fprintf(stderr, "\033[33m[!]\033[0m could not pin %d of %d detection workers to a cpu\n",
+                unpinned, pool->workers);
+    }
+    if (pool->workers == 0) {
+        pthread_mutex_destroy(&pool->lock);
+        pthread_cond_destroy(&pool->not_empty);
+        pthread_cond_destroy(&pool->not_full);
+        free(pool->threads);
+        free(pool->ring);
+        free(pool);
+        return;
+    }
+    config->detect = pool;
+}
+
+void detect_stop(config_t *config, scan_result_t *result) {
+    detect_pool_t *pool = config->detect;
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+    for (int w = 0; w < pool->workers; w++) pthread_join(pool->threads[w], NULL);
+
+    result->detect_workers = pool->workers;
+    result->detect_jobs = pool->jobs;
+    result->detect_depth_sum = pool->depth_sum;
+    result->detect_depth_max = pool->depth_max;
+    result->detect_stalls = pool->stalls;
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->not_empty);
+    pthread_cond_destroy(&pool->not_full);
+    free(pool->threads);
+    free(pool->ring);
+    free(pool);
+    config->detect = NULL;
+}
+
+detect_job_t *detect_job_new(CURL *curl, response_t *resp, char *test_url, host_t *host, int url_idx, int payload_idx,
+                             int batch) {
+    detect_job_t *job = calloc(1, sizeof(detect_job_t));
+    job->resp = resp;
+    job->test_url = test_url;
+    job->host = host;
+    job->url_idx = url_idx;
+    job->payload_idx = payload_idx;
+    job->batch = batch;
+    job->detect_us = -1;
+
+    if (resp && curl) {
+        curl_off_t total = 0, ttfb = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &job->status);
+        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+        curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &ttfb);
+        job->total_us = total;
+        job->ttfb_us = ttfb;
+    }
+    return job;
+}
+
+void detect_job_free(detect_job_t *job) {
+    free_response(job->resp);
+    free(job->test_url);
+    free(job);
+}
+
+detect_inbox_t *detect_inbox_new(void) {
+    detect_inbox_t *inbox = calloc(1, sizeof(detect_inbox_t));
+    pthread_mutex_init(&inbox->lock, NULL);
+    pthread_cond_init(&inbox->ready, NULL);
+    return inbox;
+}
+
+void detect_inbox_free(detect_inbox_t *inbox) {
+    if (!inbox) return;
+
+    pthread_mutex_destroy(&inbox->lock);
+    pthread_cond_destroy(&inbox->ready);
+    free(inbox);
+}
+
+static void add_pending(detect_inbox_t *inbox, detect_job_t *job) {
+    job->inbox = inbox;
+    pthread_mutex_lock(&inbox->lock);
+    inbox->pending++;
+    pthread_mutex_unlock(&inbox->lock);
+}
+
+static void enqueue(detect_pool_t *pool, detect_job_t *job) {
+    pool->ring[(pool->head + pool->count) % DETECT_QUEUE_DEPTH] = job;
+    pool->count++;
+    pool->jobs++;
+    pool->depth_sum += pool->count;
+    if (pool->count > pool->depth_max) pool->depth_max = pool->count;
+    pthread_cond_signal(&pool->not_empty);
+}
+
+void detect_submit(config_t *config, detect_inbox_t *inbox, detect_job_t *job) {
+    detect_pool_t *pool = config->detect;
+    add_pending(inbox, job);
+
+    if (!pool) {
+        scan_detect(config, job);
+        deliver(job);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->count == DETECT_QUEUE_DEPTH) pool->stalls++;
+    while (pool->count == DETECT_QUEUE_DEPTH) {
+        pthread_cond_wait(&pool->not_full, &pool->lock);
+    }
+    enqueue(pool, job);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+bool detect_try_submit(config_t *config, detect_inbox_t *inbox, detect_job_t *job) {
+    detect_pool_t *pool = config->detect;
+    if (!pool) {
+        detect_submit(config, inbox, job);
+        return true;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->count == DETECT_QUEUE_DEPTH) {
+        pool->stalls++;
+        pthread_mutex_unlock(&pool->lock);
+        return false;
+    }
+    add_pending(inbox, job);
+    enqueue(pool, job);
+    pthread_mutex_unlock(&pool->lock);
+    return true;
+}
+
+bool detect_full(config_t *config) {
+    detect_pool_t *pool = config->detect;
+    if (!pool) return false;
+
+    pthread_mutex_lock(&pool->lock);
+    bool full = pool->count == DETECT_QUEUE_DEPTH;
+    pthread_mutex_unlock(&pool->lock);
+    return full;
+}
+
+detect_job_t *detect_take(detect_inbox_t *inbox, bool wait) {
+    pthread_mutex_lock(&inbox->lock);
+    while (wait && !inbox->head && inbox->pending > 0) {
+        pthread_cond_wait(&inbox->ready, &inbox->lock);
+    }
+    detect_job_t *jobs = inbox->head;
+    for (detect_job_t *job = jobs; job; job = job->next) inbox->pending--;
+    inbox->head = NULL;
+    inbox->tail = NULL;
+    pthread_mutex_unlock(&inbox->lock);
+    return jobs;
+}
+
+int detect_pending(detect_inbox_t *inbox) {
+    pthread_mutex_lock(&inbox->lock);
+    int pending = inbox->pending;
+    pthread_mutex_unlock(&inbox->lock);
+    return pending;
+}
@@ -0,0 +1,163 @@
+#include "xssmap.h"
+
+struct window_feed {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    url_window_t windows[URL_WINDOWS];
+    long published;
+    long retired;
+    bool closed;
+    bool stopped;
+};
+
+void feed_init(config_t *config, long first) {
+    window_feed_t *feed = calloc(1, sizeof(window_feed_t));
+    pthread_mutex_init(&feed->lock, NULL);
+    pthread_cond_init(&feed->changed, NULL);
+    for (int w = 0; w < URL_WINDOWS; w++) {
+        feed->windows[w].base = w * config->url_window;
+        pthread_mutex_init(&feed->windows[w].lock, NULL);
+    }
+    feed->published = first;
+    feed->retired = first;
+
+    config->url_slots = URL_WINDOWS * config->url_window;
+    config->urls = calloc(config->url_slots, sizeof(char *));
+    config->feed = feed;
+}
+
+void feed_free(config_t *config) {
+    window_feed_t *feed = config->feed;
+    if (!feed) return;
+
+    for (int w = 0; w < URL_WINDOWS; w++) pthread_mutex_destroy(&feed->windows[w].lock);
+    pthread_mutex_destroy(&feed->lock);
+    pthread_cond_destroy(&feed->changed);
+    free(feed);
+    free(config->urls);
+    config->urls = NULL;
+    config->url_slots = 0;
+    config->feed = NULL;
+}
+
+url_window_t *feed_open(config_t *config) {
+    window_feed_t *feed = config->feed;
+
+    pthread_mutex_lock(&feed->lock);
+    url_window_t *window = NULL;
+    if (!feed->stopped && feed->published - feed->retired < URL_WINDOWS) {
+        window = &feed->windows[feed->published % URL_WINDOWS];
+        window->seq = feed->published;
+        window->count = 0;
+        window->read = 0;
+        window->schedule = NULL;
+        window->schedule_len = 0;
+        window->hosts = NULL;
+        window->ranges = NULL;
+        window->span = 0;
+        window->next_task = 0;
+        window->exhausted = false;
+        window->users = 0;
+        atomic_store(&window->pending, 0);
+    }
+    pthread_mutex_unlock(&feed->lock);
+    return window;
+}
+
+void feed_publish(config_t *config, url_window_t *window) {
+    window_feed_t *feed = config->feed;
+
+    pthread_mutex_lock(&feed->lock);
+    feed->published = window->seq + 1;
+    pthread_cond_broadcast(&feed->changed);
+    pthread_mutex_unlock(&feed->lock);
+}
+
+void feed_close(config_t *config) {
+    window_feed_t *feed = config->feed;
+
+    pthread_mutex_lock(&feed->lock);
+    feed->closed = true;
+    pthread_cond_broadcast(&feed->changed);
+    pthread_mutex_unlock(&feed->lock);
+}
+
+void feed_stop(config_t *config) {
+    window_feed_t *feed = config->feed;
+
+    pthread_mutex_lock(&feed->lock);
+    feed->stopped = true;
+    pthread_cond_broadcast(&feed->changed);
+    pthread_mutex_unlock(&feed->lock);
+}
+
+bool feed_stopped(config_t *config) {
+    window_feed_t *feed = config->feed;
+
+    pthread_mutex_lock(&feed->lock);
+    bool stopped = feed->stopped;
+    pthread_mutex_unlock(&feed->lock);
+    return stopped;
+}
+
+url_window_t *feed_retire(config_t *config) {
+    window_feed_t *feed = config->feed;
+
+    pthread_mutex_lock(&feed->lock);
+    url_window_t *window = NULL;
+    if (feed->retired < feed->published) {
+        window = &feed->windows[feed->retired % URL_WINDOWS];
+        while (!(window->exhausted || feed->stopped) || window->users > 0 || atomic_load(&window->pending) > 0) {
+            pthread_cond_wait(&feed->changed, &feed->lock);
+        }
+        feed->retired++;
+    }
+    pthread_mutex_unlock(&feed->lock);
+    return window;
+}
+
+url_window_t *feed_next(config_t *config, long seq, bool wait) {
+    window_feed_t *feed = config->feed;
+
+    pthread_mutex_lock(&feed->lock);
+    if (seq < feed->retired) seq = feed->retired;
+    while (wait && seq >= feed->published && !feed->closed && !feed->stopped) {
+        pthread_cond_wait(&feed->changed, &feed->lock);
+    }
+    url_window_t *window = NULL;
+    if (!feed->stopped && seq < feed->published) {
+        window = &feed->windows[seq % URL_WINDOWS];
+        window->users++;
+    }
+    pthread_mutex_unlock(&feed->lock);
+    return window;
+}
+
+void window_leave(config_t *config, url_window_t *window) {
+    window_feed_t *feed = config->feed;
+
+    pthread_mutex_lock(&feed->lock);
+    window->exhausted = true;
+    window->users--;
+    pthread_cond_broadcast(&feed->changed);
+    pthread_mutex_unlock(&feed->lock);
+}
+
+url_window_t *window_of(const config_t *config, int url_idx) {
+    return &config->feed->windows[url_idx / config->url_window];
+}
+
+void window_hold(url_window_t *window, int count) {
+    atomic_fetch_add(&window->pending, count);
+}
+
+void window_release(config_t *config, int url_idx, int count) {
+    if (count <= 0) return;
+
+    url_window_t *window = window_of(config, url_idx);
+    if (atomic_fetch_sub(&window->pending, count) != count) return;
+
+    pthread_mutex_lock(&config->feed->lock);
+    pthread_cond_broadcast(&config->feed->changed);
+    pthread_mutex_unlock(&config->feed->lock);
+}
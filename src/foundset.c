@@ -0,0 +1,116 @@
+#include "xssmap.h"
+
+static uint64_t point_hash(const char *url) {
+    char key[MAX_URL_LEN * 2];
+    if (!url_point_key(url, key, sizeof(key))) return hash64(url, strlen(url)) | 1;
+
+    uint64_t hash = hash64(key, strlen(key));
+    return hash ? hash : 1;
+}
+
+#define EPOCH_MASK ((1ULL << FOUND_EPOCH_BITS) - 1)
+
+static uint64_t point_tag(uint64_t hash) {
+    uint64_t tag = hash >> FOUND_EPOCH_BITS;
+    return tag ? tag : 1;
+}
+
+static int64_t epoch_lag(uint64_t entry, uint64_t epoch) {
+    int64_t lag = (int64_t)((epoch - (entry & EPOCH_MASK)) & EPOCH_MASK);
+    return lag > (int64_t)(EPOCH_MASK >> 1) ? lag - (int64_t)EPOCH_MASK - 1 : lag;
+}
+
+static bool entry_live(uint64_t entry, uint64_t epoch) {
+    int64_t lag = epoch_lag(entry, epoch);
+    return entry != 0 && lag <= 1 && lag >= -1;
+}
+
+static uint64_t current_epoch(const config_t *config) {
+    return (uint64_t)atomic_load(&config->found_epoch) & EPOCH_MASK;
+}
+
+static void count_point(config_t *config) {
+    long limit = (long)(config->found_slots / 4);
+    if (atomic_fetch_add(&config->found_points, 1) + 1 != limit) return;
+
+    atomic_store(&config->found_points, 0);
+    atomic_fetch_add(&config->found_epoch, 1);
+}
+
+static void refresh(config_t *config, atomic_uint_least64_t *slot, uint64_t entry, uint64_t epoch) {
+    if (epoch_lag(entry, epoch) <= 0) return;
+
+    uint_least64_t expected = entry;
+    if (atomic_compare_exchange_strong_explicit(slot, &expected, (entry & ~EPOCH_MASK) | epoch,
+                                                memory_order_release, memory_order_relaxed)) {
+        count_point(config);
+    }
+}
+
+void found_set_init(config_t *config) {
+    free(config->url_point);
+    free(config->found_set);
+    config->url_point = NULL;
+    config->found_set = NULL;
+    config->found_slots = 0;
+    if (!config->first_hit) return;
+
+    size_t points = config->url_slots > FOUND_SET_POINTS ? (size_t)config->url_slots : FOUND_SET_POINTS;
+    size_t slots = 16;
+    while (slots < points * 2) slots *= 2;
+
+    config->url_point = malloc(config->url_slots * sizeof(uint64_t));
+    config->found_set = calloc(slots, sizeof(atomic_uint_least64_t));
+    config->found_slots = slots;
+    atomic_store(&config->found_points, 0);
+    atomic_store(&config->found_epoch, 0);
+}
+
+void found_set_points(config_t *config, const url_window_t *window) {
+    if (!config->found_set) return;
+
+    for (int u = window->base; u < window->base + window->count; u++) {
+        config->url_point[u] = point_hash(config->urls[u]);
+    }
+}
+
+bool found_set_contains(config_t *config, int url_idx) {
+    if (!config->found_set) return false;
+
+    uint64_t hash = config->url_point[url_idx];
+    uint64_t tag = point_tag(hash);
+    uint64_t epoch = current_epoch(config);
+    size_t mask = config->found_slots - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        uint64_t cur = atomic_load_explicit(&config->found_set[slot], memory_order_acquire);
+        if (!entry_live(cur, epoch)) return false;
+        if (cur >> FOUND_EPOCH_BITS == tag) {
+            refresh(config, &config->found_set[slot], cur, epoch);
+            return true;
+        }
+    }
+}
+
+void found_set_insert(config_t *config, int url_idx) {
+    if (!config->found_set) return;
+
+    uint64_t hash = config->url_point[url_idx];
+    uint64_t tag = point_tag(hash);
+    uint64_t epoch = current_epoch(config);
+    uint64_t entry = tag << FOUND_EPOCH_BITS | epoch;
+    size_t mask = config->found_slots - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        uint_least64_t cur = atomic_load_explicit(&config->found_set[slot], memory_order_acquire);
+        while (!entry_live(cur, epoch)) {
+            if (atomic_compare_exchange_strong_explicit(&config->found_set[slot], &cur, entry,
+                                                        memory_order_release, memory_order_acquire)) {
+                count_point(config);
+                return;
+            }
+        }
+        if (cur >> FOUND_EPOCH_BITS == tag) {
+            refresh(config, &config->found_set[slot], cur, epoch);
+            return;
+        }
+    }
+}
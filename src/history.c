@@ -0,0 +1,262 @@
+#include "xssmap.h"
+#include <unistd.h>
+
+static const char *context_names[HISTORY_CONTEXTS] = {
+    "unknown", "html_text", "html_comment", "tag_name", "attr_name",
+    "attr_unquoted", "attr_single", "attr_double", "script_data", "script_single",
+    "script_double", "script_template", "style_data", "url", "noscript", "cdata",
+};
+
+typedef struct {
+    double score;
+    int idx;
+} ranked_t;
+
+typedef struct {
+    int *slots;
+    size_t mask;
+} payload_map_t;
+
+static void map_build(payload_map_t *map, char **payloads, int count) {
+    size_t slots = 16;
+    while (slots < (size_t)count * 2) slots *= 2;
+    map->slots = malloc(slots * sizeof(int));
+    map->mask = slots - 1;
+    for (size_t i = 0; i < slots; i++) map->slots[i] = -1;
+
+    for (int p = 0; p < count; p++) {
+        size_t slot = hash64(payloads[p], strlen(payloads[p])) & map->mask;
+        while (map->slots[slot] >= 0) slot = (slot + 1) & map->mask;
+        map->slots[slot] = p;
+    }
+}
+
+const char *context_name(html_context_t context) {
+    return context >= 0 && context < HISTORY_CONTEXTS ? context_names[context] : context_names[CTX_UNKNOWN];
+}
+
+static int context_id(const char *name, size_t len) {
+    for (int c = 0; c < HISTORY_CONTEXTS; c++) {
+        if (strlen(context_names[c]) == len && strncmp(context_names[c], name, len) == 0) return c;
+    }
+    return CTX_UNKNOWN;
+}
+
+static bool parse_line(const char *line, long *tries, long *hits, const char **payload) {
+    char *end;
+    *tries = strtol(line, &end, 10);
+    if (*end != '\t' || *tries < 0) return false;
+
+    const char *ctx = end + 1;
+    const char *tab = strchr(ctx, '\t');
+    if (!tab || tab[1] == '\0') return false;
+    *payload = tab + 1;
+
+    memset(hits, 0, HISTORY_CONTEXTS * sizeof(long));
+    if (*ctx == '-') return true;
+    while (ctx < tab) {
+        const char *colon = memchr(ctx, ':', tab - ctx);
+        if (!colon) return false;
+        long n = strtol(colon + 1, &end, 10);
+        if (n < 0 || (end != tab && *end != ',')) return false;
+        hits[context_id(ctx, colon - ctx)] += n;
+        ctx = end + (end != tab);
+    }
+    return true;
+}
+
+static void apply_line(history_t *history, char **payloads, payload_map_t *map, const char *line) {
+    long tries;
+    long hits[HISTORY_CONTEXTS];
+    const char *payload;
+    if (!parse_line(line, &tries, hits, &payload)) return;
+
+    bool known = false;
+    for (size_t slot = hash64(payload, strlen(payload)) & map->mask; map->slots[slot] >= 0;
+         slot = (slot + 1) & map->mask) {
+        int p = map->slots[slot];
+        if (strcmp(payloads[p], payload) != 0) continue;
+
+        history->tries[p] += tries;
+        for (int c = 0; c < HISTORY_CONTEXTS; c++) history->hits[(size_t)p * HISTORY_CONTEXTS + c] += hits[c];
+        known = true;
+    }
+    if (known) {
+        history->past_tries += tries;
+        for (int c = 0; c < HISTORY_CONTEXTS; c++) history->past_hits += hits[c];
+        return;
+    }
+
+    history->extra = realloc(history->extra, (history->extra_count + 1) * sizeof(char *));
+    history->extra[history->extra_count++] = strdup(line);
+}
+
+static long total_hits(const long *hits) {
+    long total = 0;
+    for (int c = 0; c < HISTORY_CONTEXTS; c++) total += hits[c];
+    return total;
+}
+
+static int compare_ranked(const void *a, const void *b) {
+    const ranked_t *x = a;
+    const ranked_t *y = b;
+    if (x->score != y->score) return x->score < y->score ? 1 : -1;
+    return x->idx - y->idx;
+}
+
+static void reorder(config_t *config, history_t *history) {
+    int n = config->payload_count;
+    double prior = history->past_tries > 0 ? (double)history->past_hits / history->past_tries : 0;
+
+    ranked_t *ranked = malloc(n * sizeof(ranked_t));
+    for (int p = 0; p < n; p++) {
+        long hits = total_hits(&history->hits[(size_t)p * HISTORY_CONTEXTS]);
+        ranked[p].score = (hits + HISTORY_PRIOR_WEIGHT * prior) / (history->tries[p] + HISTORY_PRIOR_WEIGHT);
+        ranked[p].idx = p;
+    }
+    qsort(ranked, n, sizeof(ranked_t), compare_ranked);
+
+    char **payloads = malloc(n * sizeof(char *));
+    long *tries = malloc(n * sizeof(long));
+    long *hits = malloc((size_t)n * HISTORY_CONTEXTS * sizeof(long));
+    for (int p = 0; p < n; p++) {
+        int from = ranked[p].idx;
+        if (from != p) history->moved++;
+        payloads[p] = config->payloads[from];
+        tries[p] = history->tries[from];
+        memcpy(&hits[(size_t)p * HISTORY_CONTEXTS], &history->hits[(size_t)from * HISTORY_CONTEXTS],
+               HISTORY_CONTEXTS * sizeof(long));
+    }
+
+    free(config->payloads);
+    free(history->tries);
+    free(history->hits);
+    config->payloads = payloads;
+    history->tries = tries;
+    history->hits = hits;
+    free(ranked);
+}
+
+void history_load(config_t *config) {
+    if (!config->stats_file) return;
+
+    int n = config->payload_count;
+    history_t *history = calloc(1, sizeof(history_t));
+    history->tries = calloc(n, sizeof(long));
+    history->hits = calloc((size_t)n * HISTORY_CONTEXTS, sizeof(long));
+    history->run_tries = calloc(n, sizeof(atomic_long));
+    history->run_hits = calloc((size_t)n * HISTORY_CONTEXTS, sizeof(atomic_long));
+    history->canonical = malloc(n * sizeof(int));
+
+    payload_map_t map;
+    map_build(&map, config->payloads, n);
+
+    int line_count = 0;
+    char **lines = load_file_lines(config->stats_file, &line_count);
+    for (int i = 0; i < line_count; i++) {
+        if (lines[i][0] != '#') apply_line(history, config->payloads, &map, lines[i]);
+    }
+    free_lines(lines, line_count);
+    free(map.slots);
+
+    if (history->past_tries > 0) reorder(config, history);
+
+    map_build(&map, config->payloads, n);
+    for (int p = 0; p < n; p++) {
+        history->canonical[p] = p;
+        for (size_t slot = hash64(config->payloads[p], strlen(config->payloads[p])) & map.mask;
+             map.slots[slot] >= 0; slot = (slot + 1) & map.mask) {
+            int q = map.slots[slot];
+            if (q < history->canonical[p] && strcmp(config->payloads[q], config->payloads[p]) == 0) {
+                history->canonical[p] = q;
+            }
+        }
+    }
+    free(map.slots);
+
+    config->history = history;
+}
+
+void history_record(config_t *config, int payload_idx, bool found, html_context_t context) {
+    history_t *history = config->history;
+    if (!history) return;
+
+    int p = history->canonical[payload_idx];
+    atomic_fetch_add_explicit(&history->run_tries[p], 1, memory_order_relaxed);
+    if (!found) return;
+
+    if ((unsigned)context >= HISTORY_CONTEXTS) context = CTX_UNKNOWN;
+    atomic_fetch_add_explicit(&history->run_hits[(size_t)p * HISTORY_CONTEXTS + context], 1, memory_order_relaxed);
+}
+
+static void write_contexts(FILE *f, const long *hits) {
+    bool any = false;
+    for (int c = 0; c < HISTORY_CONTEXTS; c++) {
+        if (hits[c] == 0) continue;
+        fprintf(f, "%s%s:%ld", any ? "," : "", context_names[c], hits[c]);
+        any = true;
+    }
+    if (!any) fputc('-', f);
+}
+
+bool history_save(const config_t *config) {
+    history_t *history = config->history;
+    if (!history) return true;
+
+    char tmp[MAX_URL_LEN];
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", config->stats_file, (int)getpid());
+    FILE *f = fopen(tmp, "w");
+    if (!f) return false;
+
+    fprintf(f, "# xssmap payload stats: tries, hits by context, payload\n");
+    for (int p = 0; p < config->payload_count; p++) {
+        if (history->canonical[p] != p) continue;
+
+        long hits[HISTORY_CONTEXTS];
+        long tries = history->tries[p] + atomic_load(&history->run_tries[p]);
+        for (int c = 0; c < HISTORY_CONTEXTS; c++) {
+            size_t idx = (size_t)p * HISTORY_CONTEXTS + c;
+            hits[c] = history->hits[idx] + atomic_load(&history->run_hits[idx]);
+        }
+        if (tries == 0) continue;
+
+        fprintf(f, "%ld\t", tries);
+        write_contexts(f, hits);
+        fprintf(f, "\t%s\n", config->payloads[p]);
+    }
+    for (int i = 0; i < history->extra_count; i++) {
+        fprintf(f, "%s\n", history->extra[i]);
+    }
+
+    bool ok = fclose(f) == 0 && rename(tmp, config->stats_file) == 0;
+    if (!ok) remove(tmp);
+    return ok;
+}
+
+void history_run_totals(const config_t *config, long *tries, long *hits) {
+    history_t *history = config->history;
+    *tries = 0;
+    *hits = 0;
+    if (!history) return;
+
+    for (int p = 0; p < config->payload_count; p++) {
+        *tries += atomic_load(&history->run_tries[p]);
+        for (int c = 0; c < HISTORY_CONTEXTS; c++) {
+            *hits += atomic_load(&history->run_hits[(size_t)p * HISTORY_CONTEXTS + c]);
+        }
+    }
+}
+
+void history_free(config_t *config) {
+    history_t *history = config->history;
+    if (!history) return;
+
+    free(history->tries);
+    free(history->hits);
+    free(history->run_tries);
+    free(history->run_hits);
+    free(history->canonical);
+    free_lines(history->extra, history->extra_count);
+    free(history);
+    config->history = NULL;
+}
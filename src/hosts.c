@@ -0,0 +1,290 @@
+#include "xssmap.h"
+
+#define HOST_BUCKETS_INITIAL 256
+
+static host_t **buckets;
+static size_t bucket_count;
+static size_t host_count;
+static long generation;
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void hosts_init(void) {
+    pthread_mutex_lock(&table_lock);
+    if (!buckets) {
+        bucket_count = HOST_BUCKETS_INITIAL;
+        buckets = calloc(bucket_count, sizeof(host_t *));
+        host_count = 0;
+    }
+    pthread_mutex_unlock(&table_lock);
+}
+
+static void host_free(host_t *host) {
+    pthread_mutex_destroy(&host->lock);
+    pthread_cond_destroy(&host->cond);
+    free(host->timing);
+    free(host->key);
+    free(host);
+}
+
+void hosts_cleanup(void) {
+    pthread_mutex_lock(&table_lock);
+    for (size_t i = 0; i < bucket_count; i++) {
+        host_t *host = buckets[i];
+        while (host) {
+            host_t *next = host->next;
+            host_free(host);
+            host = next;
+        }
+    }
+    free(buckets);
+    buckets = NULL;
+    bucket_count = 0;
+    host_count = 0;
+    pthread_mutex_unlock(&table_lock);
+}
+
+static void grow_table(void) {
+    size_t new_count = bucket_count * 2;
+    host_t **new_buckets = calloc(new_count, sizeof(host_t *));
+    if (!new_buckets) return;
+
+    for (size_t i = 0; i < bucket_count; i++) {
+        host_t *host = buckets[i];
+        while (host) {
+            host_t *next = host->next;
+            size_t slot = hash64(host->key, strlen(host->key)) % new_count;
+            host->next = new_buckets[slot];
+            new_buckets[slot] = host;
+            host = next;
+        }
+    }
+
+    free(buckets);
+    buckets = new_buckets;
+    bucket_count = new_count;
+}
+
+host_t *host_lookup(const char *url) {
+    char key[MAX_URL_LEN];
+    if (!url_host_key(url, key, sizeof(key))) return NULL;
+
+    uint64_t hash = hash64(key, strlen(key));
+
+    pthread_mutex_lock(&table_lock);
+    if (!buckets) {
+        pthread_mutex_unlock(&table_lock);
+        return NULL;
+    }
+
+    host_t *host = buckets[hash % bucket_count];
+    while (host && strcmp(host->key, key) != 0) host = host->next;
+
+    if (!host) {
+        host = calloc(1, sizeof(host_t));
+        host->key = strdup(key);
+        pthread_mutex_init(&host->lock, NULL);
+        pthread_cond_init(&host->cond, NULL);
+        host->window = AIMD_INITIAL_WINDOW;
+
+        if (host_count >= bucket_count * 2) grow_table();
+        size_t slot = hash % bucket_count;
+        host->next = buckets[slot];
+        buckets[slot] = host;
+        host_count++;
+    }
+    host->seen = generation;
+    pthread_mutex_unlock(&table_lock);
+
+    return host;
+}
+
+void hosts_advance(long seq) {
+    pthread_mutex_lock(&table_lock);
+    generation = seq;
+    pthread_mutex_unlock(&table_lock);
+}
+
+static bool host_idle(host_t *host) {
+    pthread_mutex_lock(&host->lock);
+    bool idle = host->in_flight == 0 && host->active == 0;
+    pthread_mutex_unlock(&host->lock);
+    return idle;
+}
+
+long hosts_trim(long retired) {
+    long evicted = 0;
+
+    pthread_mutex_lock(&table_lock);
+    for (size_t i = 0; i < bucket_count && host_count > HOST_TABLE_MAX; i++) {
+        host_t **link = &buckets[i];
+        while (*link) {
+            host_t *host = *link;
+            if (host->seen > retired || !host_idle(host)) {
+                link = &host->next;
+                continue;
+            }
+            *link = host->next;
+            host_free(host);
+            host_count--;
+            evicted++;
+        }
+    }
+    pthread_mutex_unlock(&table_lock);
+    return evicted;
+}
+
+void hosts_foreach(void (*fn)(host_t *host, void *ctx), void *ctx) {
+    pthread_mutex_lock(&table_lock);
+    for (size_t i = 0; i < bucket_count; i++) {
+        for (host_t *host = buckets[i]; host; host = host->next) {
+            fn(host, ctx);
+        }
+    }
+    pthread_mutex_unlock(&table_lock);
+}
+
+static bool has_capacity(host_t *host, int limit) {
+    if (host->window > limit) host->window = limit;
+    int window = (int)host->window;
+    if (window < 1) window = 1;
+    return host->in_flight < window;
+}
+
+void host_acquire(host_t *host, int limit) {
+    pthread_mutex_lock(&host->lock);
+    while (!has_capacity(host, limit)) {
+        pthread_cond_wait(&host->cond, &host->lock);
+    }
+    host->in_flight++;
+    pthread_mutex_unlock(&host->lock);
+}
+
+bool host_try_acquire(host_t *host, int limit) {
+    pthread_mutex_lock(&host->lock);
+    bool ok = has_capacity(host, limit);
+    if (ok) host->in_flight++;
+    pthread_mutex_unlock(&host->lock);
+    return ok;
+}
+
+void host_enter(host_t *host, int cap) {
+    pthread_mutex_lock(&host->lock);
+    while (host->active >= cap) {
+        pthread_cond_wait(&host->cond, &host->lock);
+    }
+    host->active++;
+    pthread_mutex_unlock(&host->lock);
+}
+
+bool host_try_enter(host_t *host, int cap) {
+    pthread_mutex_lock(&host->lock);
+    bool ok = host->active < cap;
+    if (ok) host->active++;
+    pthread_mutex_unlock(&host->lock);
+    return ok;
+}
+
+void host_leave(host_t *host) {
+    pthread_mutex_lock(&host->lock);
+    host->active--;
+    pthread_cond_broadcast(&host->cond);
+    pthread_mutex_unlock(&host->lock);
+}
+
+void host_release(host_t *host, double latency_ms, host_outcome_t outcome) {
+    pthread_mutex_lock(&host->lock);
+    host->in_flight--;
+    host->requests++;
+
+    if (outcome == HOST_OK) {
+        if (host->base_latency <= 0 || latency_ms < host->base_latency) {
+            host->base_latency = latency_ms;
+        } else {
+            host->base_latency = host->base_latency * 0.99 + latency_ms * 0.01;
+        }
+        host->avg_latency = host->avg_latency > 0 ? host->avg_latency * 0.8 + latency_ms * 0.2 : latency_ms;
+
+        if (host->avg_latency <= host->base_latency * AIMD_LATENCY_SLACK + AIMD_LATENCY_FLOOR_MS) {
+            host->window += 1.0 / host->window;
+        }
+    } else if (outcome == HOST_CONGESTED) {
+        long now = monotonic_ms();
+        if (now - host->last_backoff >= host->avg_latency) {
+            host->window *= AIMD_BACKOFF;
+            if (host->window < 1.0) host->window = 1.0;
+            host->last_backoff = now;
+            host->backoffs++;
+        }
+    }
+
+    pthread_cond_broadcast(&host->cond);
+    pthread_mutex_unlock(&host->lock);
+}
+
+bool host_breaker_allow(host_t *host) {
+    pthread_mutex_lock(&host->lock);
+    if (host->breaker == BREAKER_OPEN && monotonic_ms() >= host->open_until) {
+        host->breaker = BREAKER_HALF_OPEN;
+        host->probing = false;
+    }
+
+    bool ok = host->breaker == BREAKER_CLOSED;
+    if (host->breaker == BREAKER_HALF_OPEN && !host->probing) {
+        host->probing = true;
+        ok = true;
+    }
+    pthread_mutex_unlock(&host->lock);
+    return ok;
+}
+
+bool host_breaker_open(host_t *host) {
+    pthread_mutex_lock(&host->lock);
+    bool open = host->breaker != BREAKER_CLOSED;
+    pthread_mutex_unlock(&host->lock);
+    return open;
+}
+
+void host_breaker_record(host_t *host, bool failed, int threshold) {
+    pthread_mutex_lock(&host->lock);
+    if (!failed) {
+        host->successes++;
+        host->failures = 0;
+        host->breaker = BREAKER_CLOSED;
+        host->probing = false;
+    } else {
+        host->failures++;
+        if (host->breaker == BREAKER_HALF_OPEN ||
+            (host->breaker == BREAKER_CLOSED && host->failures >= threshold)) {
+            if (host->breaker == BREAKER_CLOSED) host->trips++;
+            host->breaker = BREAKER_OPEN;
+            host->open_until = monotonic_ms() + BREAKER_COOLDOWN_MS;
+            host->probing = false;
+        }
+    }
+    pthread_mutex_unlock(&host->lock);
+}
+
+bool host_seen_alive(host_t *host) {
+    pthread_mutex_lock(&host->lock);
+    bool alive = host->successes > 0;
+    pthread_mutex_unlock(&host->lock);
+    return alive;
+}
+
+bool host_fingerprint_seen(host_t *host, uint64_t fingerprint) {
+    pthread_mutex_lock(&host->lock);
+    bool seen = false;
+    for (int i = 0; i < host->fingerprint_count && !seen; i++) {
+        seen = host->fingerprints[i] == fingerprint;
+    }
+    pthread_mutex_unlock(&host->lock);
+    return seen;
+}
+
+void host_fingerprint_add(host_t *host, uint64_t fingerprint) {
+    pthread_mutex_lock(&host->lock);
+    host->fingerprints[host->fingerprint_next] = fingerprint;
+    host->fingerprint_next = (host->fingerprint_next + 1) % FINGERPRINT_CACHE;
+    if (host->fingerprint_count < FINGERPRINT_CACHE) host->fingerprint_count++;
+    pthread_mutex_unlock(&host->lock);
+}
@@ -1,46 +1,292 @@
 #include "xssmap.h"
+#include <strings.h>
+#include <ctype.h>
+#include <arpa/inet.h>
+#ifdef XSSMAP_OPENSSL
+#include <openssl/ssl.h>
+#endif
 
 extern const char *get_random_ua(void);
 
+static CURLSH *share;
+static pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+
+static void share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userp) {
+    (void)handle;
+    (void)access;
+    (void)userp;
+    pthread_mutex_lock(&share_locks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userp) {
+    (void)handle;
+    (void)userp;
+    pthread_mutex_unlock(&share_locks[data]);
+}
+
+static curl_off_t wire_remaining(CURL *curl) {
+    curl_off_t length = -1;
+    curl_off_t received = 0;
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &received);
+    return length < 0 ? -1 : length - received;
+}
+
+static bool content_encoded(CURL *curl) {
+    struct curl_header *header = NULL;
+    if (curl_easy_header(curl, "Content-Encoding", 0, CURLH_HEADER, -1, &header) != CURLHE_OK) return false;
+    return strcasecmp(header->value, "identity") != 0;
+}
+
+static bool worth_aborting(response_t *resp) {
+    long version = 0;
+    curl_easy_getinfo(resp->curl, CURLINFO_HTTP_VERSION, &version);
+    if (version >= CURL_HTTP_VERSION_2_0) return true;
+
+    curl_off_t remaining = wire_remaining(resp->curl);
+    return remaining < 0 || remaining >= STREAM_ABORT_MIN;
+}
+
+static bool stream_should_abort(response_t *resp) {
+    if (!resp->reflected) {
+        size_t from = resp->scanned >= resp->payload_len ? resp->scanned - resp->payload_len + 1 : 0;
+        const char *hit = ci_find(resp->data + from, resp->size - from, resp->payload, resp->payload_len);
+        resp->scanned = resp->size;
+
+        if (!hit) {
+            return resp->window > 0 && resp->size >= resp->window && worth_aborting(resp);
+        }
+        resp->reflected = true;
+        resp->reflected_at = hit - resp->data;
+    }
+
+    if (resp->checked > 0 || resp->size < resp->reflected_at + resp->payload_len + STREAM_TAIL) return false;
+    resp->checked = resp->size;
+
+    if (run_all_techniques(resp->data, resp->payload, &resp->det) && resp->det.confidence >= 70) {
+        resp->verdict = STREAM_CONFIRMED;
+        return worth_aborting(resp);
+    }
+    return false;
+}
+
+static void stream_settle(response_t *resp) {
+    if (!resp || !resp->payload || resp->verdict != STREAM_UNDECIDED) return;
+
+    if (!resp->reflected) {
+        resp->verdict = STREAM_UNREFLECTED;
+    } else if (resp->checked == resp->size) {
+        resp->verdict = STREAM_CLEAN;
+    }
+}
+
+static bool grow_buffer(response_t *resp, size_t capacity) {
+    char *ptr = realloc(resp->data, capacity);
+    if (!ptr) return false;
+
+    resp->data = ptr;
+    resp->capacity = capacity;
+    if (resp->pool) resp->pool->stats->buffer_allocs++;
+    return true;
+}
+
+static bool reserve_buffer(response_t *resp, size_t needed) {
+    size_t capacity = resp->capacity > BUFFER_MIN_CAPACITY ? resp->capacity : BUFFER_MIN_CAPACITY;
+
+    if (resp->size == 0 && !content_encoded(resp->curl)) {
+        curl_off_t length = -1;
+        curl_easy_getinfo(resp->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+        if (length > 0 && (size_t)length + 1 > capacity) {
+            capacity = (size_t)length < MAX_RESPONSE_SIZE ? (size_t)length + 1 : MAX_RESPONSE_SIZE + 1;
+        }
+    }
+
+    while (capacity < needed) capacity *= 2;
+    if (capacity > MAX_RESPONSE_SIZE + 1) capacity = MAX_RESPONSE_SIZE + 1;
+
+    return grow_buffer(resp, capacity);
+}
+
+static uint64_t size_hint_key(const char *url) {
+    return hash64(url, strcspn(url, "?#"));
+}
+
+void buffer_pool_init(buffer_pool_t *pool, http_stats_t *stats) {
+    memset(pool, 0, sizeof(*pool));
+    pool->stats = stats;
+}
+
+void buffer_pool_destroy(buffer_pool_t *pool) {
+    response_t *resp = pool->free_list;
+    while (resp) {
+        response_t *next = resp->next;
+        free(resp->data);
+        free(resp);
+        resp = next;
+    }
+    pool->free_list = NULL;
+}
+
+static response_t *buffer_pool_acquire(buffer_pool_t *pool, const char *url) {
+    response_t *resp = pool ? pool->free_list : NULL;
+    if (resp) {
+        pool->free_list = resp->next;
+    } else {
+        resp = malloc(sizeof(response_t));
+        resp->data = NULL;
+        resp->capacity = 0;
+        if (pool) pool->stats->buffer_allocs++;
+    }
+
+    char *data = resp->data;
+    size_t capacity = resp->capacity;
+    memset(resp, 0, sizeof(*resp));
+    resp->data = data;
+    resp->capacity = capacity;
+    resp->pool = pool;
+    resp->hint_key = size_hint_key(url);
+
+    size_t wanted = BUFFER_MIN_CAPACITY;
+    if (pool) {
+        size_t slot = resp->hint_key % BUFFER_HINTS;
+        if (pool->hint_keys[slot] == resp->hint_key && pool->hint_sizes[slot] + 1 > wanted) {
+            wanted = pool->hint_sizes[slot] + 1;
+        }
+    }
+    if (resp->capacity < wanted && !grow_buffer(resp, wanted)) {
+        free(resp->data);
+        free(resp);
+        return NULL;
+    }
+
+    resp->data[0] = '\0';
+    return resp;
+}
+
+static bool resolved_by_name(CURL *curl) {
+    char *url = NULL;
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+    CURLU *parts = curl_url();
+    char *host = NULL;
+    bool named = false;
+    if (url && curl_url_set(parts, CURLUPART_URL, url, 0) == CURLUE_OK &&
+        curl_url_get(parts, CURLUPART_HOST, &host, 0) == CURLUE_OK) {
+        unsigned char addr[16];
+        named = host[0] != '[' && inet_pton(AF_INET, host, addr) != 1;
+    }
+    curl_free(host);
+    curl_url_cleanup(parts);
+    return named;
+}
+
+static bool tls_inspectable;
+
+static bool same_openssl(void) {
+#ifdef XSSMAP_OPENSSL
+    const curl_version_info_data *info = curl_version_info(CURLVERSION_NOW);
+    const char *theirs = info->ssl_version ? strstr(info->ssl_version, "OpenSSL/") : NULL;
+    if (!theirs || (theirs > info->ssl_version && theirs[-1] == '(')) return false;
+    theirs += strlen("OpenSSL/");
+
+    const char *ours = OpenSSL_version(OPENSSL_VERSION);
+    if (strncmp(ours, "OpenSSL ", 8) != 0) return false;
+    ours += 8;
+
+    size_t len = strcspn(ours, " ");
+    return len > 0 && strncmp(theirs, ours, len) == 0 && strcspn(theirs, " )") == len;
+#else
+    return false;
+#endif
+}
+
+static int tls_session_reused(CURL *curl) {
+#ifdef XSSMAP_OPENSSL
+    if (!tls_inspectable) return -1;
+
+    struct curl_tlssessioninfo *info = NULL;
+    if (curl_easy_getinfo(curl, CURLINFO_TLS_SSL_PTR, &info) != CURLE_OK || !info) return -1;
+    if (info->backend != CURLSSLBACKEND_OPENSSL || !info->internals) return -1;
+    return SSL_session_reused((SSL *)info->internals) ? 1 : 0;
+#else
+    (void)curl;
+    return -1;
+#endif
+}
+
+static int resolver_start(void *resolver_state, void *reserved, void *userp) {
+    (void)resolver_state;
+    (void)reserved;
+    ((response_t *)userp)->resolved = true;
+    return 0;
+}
+
 static size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
     size_t realsize = size * nmemb;
     response_t *resp = (response_t *)userp;
 
     if (resp->size + realsize > MAX_RESPONSE_SIZE) {
+        resp->truncated = true;
         return 0;
     }
 
-    char *ptr = realloc(resp->data, resp->size + realsize + 1);
-    if (!ptr) return 0;
+    if (resp->size + realsize + 1 > resp->capacity && !reserve_buffer(resp, resp->size + realsize + 1)) {
+        return 0;
+    }
+
+    if (resp->size == 0 && resp->tls_reused < 0) resp->tls_reused = tls_session_reused(resp->curl);
 
-    resp->data = ptr;
     memcpy(&(resp->data[resp->size]), contents, realsize);
     resp->size += realsize;
     resp->data[resp->size] = '\0';
 
+    if (resp->payload && stream_should_abort(resp)) {
+        resp->aborted = true;
+        return 0;
+    }
+
     return realsize;
 }
 
-response_t *http_get(const char *url, int timeout) {
-    CURL *curl = curl_easy_init();
-    if (!curl) return NULL;
+bool http_share_init(void) {
+    if (share) return true;
 
-    response_t *resp = malloc(sizeof(response_t));
-    resp->data = malloc(1);
-    resp->data[0] = '\0';
-    resp->size = 0;
+    share = curl_share_init();
+    if (!share) return false;
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&share_locks[i], NULL);
+    }
+
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    tls_inspectable = same_openssl();
+    return true;
+}
 
+void http_share_cleanup(void) {
+    if (!share) return;
+
+    curl_share_cleanup(share);
+    share = NULL;
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_destroy(&share_locks[i]);
+    }
+}
+
+struct curl_slist *http_default_headers(bool keepalive) {
     struct curl_slist *headers = NULL;
     headers = curl_slist_append(headers, "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
     headers = curl_slist_append(headers, "Accept-Language: en-US,en;q=0.5");
-    headers = curl_slist_append(headers, "Connection: close");
+    headers = curl_slist_append(headers, keepalive ? "Connection: keep-alive" : "Connection: close");
+    return headers;
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, url);
+void http_setup_handle(CURL *curl, struct curl_slist *headers, const config_t *config) {
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)resp);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, get_random_ua());
+    curl_easy_setopt(curl, CURLOPT_RESOLVER_START_FUNCTION, resolver_start);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout);
     curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
     curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 3L);
@@ -48,14 +294,225 @@ response_t *http_get(const char *url, int timeout) {
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
     curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
 
-    CURLcode res = curl_easy_perform(curl);
+    if (share) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+        curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, (long)DNS_CACHE_TIMEOUT);
+    }
 
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+    if (config->compression) {
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    }
+
+    if (config->keepalive) {
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+        curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
+    }
+
+    if (config->http2) {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    }
+}
+
+response_t *http_prepare(CURL *curl, buffer_pool_t *pool, const char *url, const char *payload,
+                         const config_t *config) {
+    response_t *resp = buffer_pool_acquire(pool, url);
+    if (!resp) return NULL;
+    resp->curl = curl;
+    resp->tls_reused = -1;
+
+    if (payload && payload[0] && config->stream_window > 0) {
+        resp->payload = payload;
+        resp->payload_len = strlen(payload);
+        resp->window = config->stream_window;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)resp);
+    curl_easy_setopt(curl, CURLOPT_RESOLVER_START_DATA, (void *)resp);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, get_random_ua());
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, config->timeout);
+
+    return resp;
+}
+
+static void record_new_connection(http_stats_t *stats, CURL *curl, response_t *resp) {
+    if (!resp) return;
+
+    if (resolved_by_name(curl)) {
+        if (resp->resolved) {
+            stats->dns_misses++;
+        } else {
+            stats->dns_hits++;
+        }
+    }
+    if (resp->tls_reused > 0) stats->tls_resumed++;
+    if (resp->tls_reused == 0) stats->tls_full++;
+}
+
+static void http_stats_record(http_stats_t *stats, CURL *curl, response_t *resp, CURLcode res) {
+    long new_conns = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &new_conns);
+    stats->requests++;
+    stats->connects += new_conns;
+    if (res != CURLE_OK) return;
+
+    if (new_conns == 0) {
+        stats->reused++;
+    } else {
+        record_new_connection(stats, curl, resp);
+    }
+
+    long version = 0;
+    curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &version);
+    if (version == CURL_HTTP_VERSION_2_0) stats->h2_responses++;
+}
+
+CURLcode http_complete(http_stats_t *stats, CURL *curl, response_t *resp, CURLcode res) {
+    if (res == CURLE_WRITE_ERROR && resp && resp->aborted) {
+        res = CURLE_OK;
+        if (resp->verdict == STREAM_CONFIRMED) {
+            stats->stream_hits++;
+        } else {
+            stats->stream_misses++;
+        }
+
+        curl_off_t remaining = wire_remaining(curl);
+        if (remaining > 0) stats->bytes_saved += remaining;
+    } else if (res == CURLE_WRITE_ERROR && resp && resp->truncated) {
+        res = CURLE_OK;
+        stats->truncated++;
+    }
+    if (res == CURLE_OK) stream_settle(resp);
+
+    curl_off_t received = 0;
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &received);
+    stats->wire_bytes += received;
+    if (resp) stats->decoded_bytes += resp->size;
+
+    timing_record_transfer(stats, curl);
+    http_stats_record(stats, curl, resp, res);
+    return res;
+}
+
+host_outcome_t http_outcome(CURL *curl, CURLcode res, double *latency_ms) {
+    curl_off_t total = 0;
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+    *latency_ms = total / 1000.0;
+
+    if (res == CURLE_OPERATION_TIMEDOUT) return HOST_CONGESTED;
+    if (res != CURLE_OK) return HOST_FAILED;
+
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    if (status == 429 || status >= 500) return HOST_CONGESTED;
+    return HOST_OK;
+}
+
+bool http_should_retry(CURL *curl, CURLcode res) {
+    switch (res) {
+        case CURLE_OK: {
+            long status = 0;
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+            return status == 429 || status == 502 || status == 503 || status == 504;
+        }
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_COULDNT_RESOLVE_HOST:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_SSL_CONNECT_ERROR:
+        case CURLE_HTTP2:
+        case CURLE_HTTP2_STREAM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool http_host_failure(CURL *curl, CURLcode res) {
+    if (res != CURLE_OK) return res != CURLE_OUT_OF_MEMORY;
+
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    return status == 502 || status == 503 || status == 504;
+}
+
+long http_retry_delay_ms(CURL *curl, int attempt) {
+    long ceiling = RETRY_BASE_MS << (attempt < 10 ? attempt : 10);
+    if (ceiling > RETRY_MAX_MS) ceiling = RETRY_MAX_MS;
+    long delay = ceiling / 2 + rand() % (ceiling / 2 + 1);
+
+    curl_off_t retry_after = 0;
+    curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retry_after);
+    if (retry_after > 0 && retry_after * 1000 > delay) {
+        delay = retry_after * 1000 < RETRY_MAX_MS ? (long)retry_after * 1000 : RETRY_MAX_MS;
+    }
+    return delay;
+}
+
+void http_stats_merge(http_stats_t *dst, const http_stats_t *src) {
+    dst->requests += src->requests;
+    dst->connects += src->connects;
+    dst->reused += src->reused;
+    dst->h2_responses += src->h2_responses;
+    dst->dns_hits += src->dns_hits;
+    dst->dns_misses += src->dns_misses;
+    dst->tls_resumed += src->tls_resumed;
+    dst->tls_full += src->tls_full;
+    dst->stream_hits += src->stream_hits;
+    dst->stream_misses += src->stream_misses;
+    dst->bytes_saved += src->bytes_saved;
+    dst->buffer_allocs += src->buffer_allocs;
+    dst->retries += src->retries;
+    dst->wire_bytes += src->wire_bytes;
+    dst->decoded_bytes += src->decoded_bytes;
+    dst->truncated += src->truncated;
+    for (int p = 0; p < PHASE_COUNT; p++) timing_merge(&dst->timing[p], &src->timing[p]);
+}
+
+bool http_client_init(http_client_t *client, const config_t *config) {
+    memset(client, 0, sizeof(*client));
+
+    client->curl = curl_easy_init();
+    if (!client->curl) return false;
+
+    client->config = config;
+    buffer_pool_init(&client->pool, &client->stats);
+    client->headers = http_default_headers(config->keepalive);
+    http_setup_handle(client->curl, client->headers, config);
+
+    return true;
+}
+
+void http_client_cleanup(http_client_t *client) {
+    if (client->curl) curl_easy_cleanup(client->curl);
+    curl_slist_free_all(client->headers);
+    buffer_pool_destroy(&client->pool);
+    client->curl = NULL;
+    client->headers = NULL;
+}
+
+response_t *http_client_get(http_client_t *client, const char *url, const char *payload) {
+    CURL *curl = client->curl;
+    if (!curl) return NULL;
+
+    response_t *resp = http_prepare(curl, &client->pool, url, payload, client->config);
+    if (!resp) {
+        client->last_code = CURLE_OUT_OF_MEMORY;
+        return NULL;
+    }
+
+    CURLcode res = curl_easy_perform(curl);
+    res = http_complete(&client->stats, curl, resp, res);
+    client->last_code = res;
 
     if (res != CURLE_OK) {
-        free(resp->data);
-        free(resp);
+        free_response(resp);
         return NULL;
     }
 
@@ -63,8 +520,27 @@ response_t *http_get(const char *url, int timeout) {
 }
 
 void free_response(response_t *resp) {
-    if (resp) {
+    if (!resp) return;
+
+    buffer_pool_t *pool = resp->pool;
+    if (!pool) {
         free(resp->data);
         free(resp);
+        return;
+    }
+
+    if (!resp->aborted && resp->size > 0) {
+        size_t slot = resp->hint_key % BUFFER_HINTS;
+        pool->hint_keys[slot] = resp->hint_key;
+        pool->hint_sizes[slot] = resp->size;
     }
+
+    if (resp->capacity > BUFFER_KEEP_MAX) {
+        free(resp->data);
+        resp->data = NULL;
+        resp->capacity = 0;
+    }
+
+    resp->next = pool->free_list;
+    pool->free_list = resp;
 }
@@ -18,15 +18,43 @@ static void print_help(void) {
     printf("\n");
     printf("\033[32m example:\033[0m\n");
     printf("    \033[36mxssmap\033[0m \033[90m-u http://target.com/page?q= -p payloads.txt\033[0m\n");
-    printf("    \033[36mxssmap\033[0m \033[90m-l urls.txt -p payloads.txt -t 20\033[0m\n\n");
+    printf("    \033[36mxssmap\033[0m \033[90m-l urls.txt -p payloads.txt -t 20\033[0m\n");
+    printf("    \033[36mxssmap\033[0m \033[90m-l urls.txt -p payloads.txt -t 4 -c 2000\033[0m\n");
+    printf("    \033[36mxssmap\033[0m \033[90m-l urls.txt -p payloads.txt --shard 1/3 -o part1.txt\033[0m\n");
+    printf("    \033[36mxssmap\033[0m \033[90mmerge -o results.txt part1.txt part2.txt part3.txt\033[0m\n\n");
     printf("\033[32m options:\033[0m\n");
     printf("    \033[97m-u\033[0m      single URL to scan \033[91m(required)\033[0m\n");
-    printf("    \033[97m-l\033[0m      file containing URLs\n");
+    printf("    \033[97m-l\033[0m      file containing URLs, read as a stream \033[90m(- for stdin)\033[0m\n");
     printf("    \033[97m-p\033[0m      payload file \033[91m(required)\033[0m\n");
     printf("    \033[97m-t\033[0m      number of threads \033[90m(default: 10)\033[0m\n");
+    printf("    \033[97m-c\033[0m      requests in flight using the event-driven engine \033[90m(default: off)\033[0m\n");
     printf("    \033[97m-T\033[0m      request timeout in seconds \033[90m(default: 10)\033[0m\n");
-    printf("    \033[97m-o\033[0m      output file for results\n");
+    printf("    \033[97m-o\033[0m      output file, findings are written as they are confirmed\n");
     printf("    \033[97m-v\033[0m      verbose output\n");
+    printf("    \033[97m--no-keepalive\033[0m  open a fresh connection for every request\n");
+    printf("    \033[97m--no-compression\033[0m do not ask for gzip/deflate/brotli/zstd responses\n");
+    printf("    \033[97m--http2\033[0m         multiplex requests over one h2 connection per host \033[90m(https, one event loop, falls back to http/1.1)\033[0m\n");
+    printf("    \033[97m--h2-streams\033[0m    concurrent streams per h2 connection \033[90m(default: 100)\033[0m\n");
+    printf("    \033[97m--adaptive\033[0m      per-host concurrency that backs off on timeouts, 429 and 5xx\n");
+    printf("    \033[97m--host-cap\033[0m      max requests in flight per host, 0 for no cap \033[90m(default: 0)\033[0m\n");
+    printf("    \033[97m--retries\033[0m       retries for timeouts, resets, 429 and 502-504 \033[90m(default: 2)\033[0m\n");
+    printf("    \033[97m--breaker\033[0m       consecutive failures before a host is paused, 0 disables \033[90m(default: 5)\033[0m\n");
+    printf("    \033[97m--no-preflight\033[0m  scan every URL even when a canary is not reflected \033[90m(the character probe still runs)\033[0m\n");
+    printf("    \033[97m--no-probe\033[0m      send every payload even when its special characters are encoded\n");
+    printf("    \033[97m--classes\033[0m       stop testing a payload class on a URL once one member is confirmed or several are blocked in a row\n");
+    printf("    \033[97m--first-hit\033[0m     stop testing a host/path/parameter after its first confirmed finding\n");
+    printf("    \033[97m--dedup\033[0m         skip detection when a reflected response repeats a clean page for the same payload on that host\n");
+    printf("    \033[97m--stats-file\033[0m    order payloads by past hit rate and record this run's hits in FILE\n");
+    printf("    \033[97m--timings\033[0m       print p50/p90/p99 per request phase and per host\n");
+    printf("    \033[97m--timings-file\033[0m  write phase and per-host percentiles to FILE as json\n");
+    printf("    \033[97m--shard\033[0m         scan only shard I of N (I/N), split by hash of url and payload, every shard repeats the preflight \033[90m(up to 2 requests per URL)\033[0m\n");
+    printf("    \033[97m--url-window\033[0m    URLs per window, the next window is prepared while one is scanned \033[90m(default: 1024)\033[0m\n");
+    printf("    \033[97m--checkpoint\033[0m    journal finished tasks to FILE and findings to FILE.log, FILE must not exist yet\n");
+    printf("    \033[97m--format\033[0m        -o format, plain urls or jsonl with payload, context, reason and timings \033[90m(default: plain)\033[0m\n");
+    printf("    \033[97m--resume\033[0m        continue the scan recorded in the --checkpoint journal\n");
+    printf("    \033[97m--detect-threads\033[0m detection workers pinned to cores, 0 runs detection on the network threads \033[90m(default: cpus this process may use)\033[0m\n");
+    printf("    \033[97m--batch\033[0m         pack up to N tagged payloads into one request, hits are re-tested alone \033[90m(default: 1)\033[0m\n");
+    printf("    \033[97m--stream-window\033[0m detect while bodies stream, stop after N KB without a raw reflection \033[90m(default: off)\033[0m\n");
     printf("    \033[97m-V\033[0m      show version\n");
     printf("    \033[97m-h\033[0m      show this help message\n\n");
     printf("\033[90m high-performance xss scanner - 10x faster than python\033[0m\n\n");
@@ -37,18 +65,67 @@ static void print_version(void) {
 }
 
 int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "merge") == 0) return run_merge(argc - 1, argv + 1);
+
     srand(time(NULL));
     curl_global_init(CURL_GLOBAL_ALL);
+    http_share_init();
+    hosts_init();
 
     config_t config = {
         .urls = NULL,
         .url_count = 0,
+        .url_slots = 0,
+        .url_stream = NULL,
+        .url_window = DEFAULT_URL_WINDOW,
+        .feed = NULL,
+        .url_origin = NULL,
+        .checkpoint_file = NULL,
+        .resume = false,
+        .journal = NULL,
         .payloads = NULL,
         .payload_count = 0,
         .threads = DEFAULT_THREADS,
         .timeout = DEFAULT_TIMEOUT,
         .verbose = false,
+        .keepalive = true,
+        .compression = true,
+        .concurrency = 0,
+        .http2 = false,
+        .h2_streams = DEFAULT_H2_STREAMS,
+        .stream_window = 0,
+        .adaptive = false,
+        .host_cap = 0,
+        .retries = DEFAULT_RETRIES,
+        .breaker = DEFAULT_BREAKER,
+        .batch = 1,
+        .preflight = true,
+        .probe = true,
+        .url_blocked = NULL,
+        .payload_needs = NULL,
+        .payload_class = NULL,
+        .class_count = 0,
+        .classes = false,
+        .class_state = NULL,
+        .dedup = false,
+        .first_hit = false,
+        .url_point = NULL,
+        .found_set = NULL,
+        .found_slots = 0,
+        .host_groups = 0,
+        .stats_file = NULL,
+        .history = NULL,
+        .timings = false,
+        .timings_file = NULL,
+        .shard_index = 0,
+        .shard_count = 1,
+        .url_hash = NULL,
+        .payload_hash = NULL,
         .output_file = NULL,
+        .jsonl = false,
+        .writer = NULL,
+        .detect_threads = -1,
+        .detect = NULL,
     };
 
     char *single_url = NULL;
@@ -56,15 +133,90 @@ int main(int argc, char *argv[]) {
     char *payload_file = NULL;
     int opt;
 
-    while ((opt = getopt(argc, argv, "u:l:p:t:T:o:vVh")) != -1) {
+    enum { OPT_NO_KEEPALIVE = 256, OPT_HTTP2, OPT_H2_STREAMS, OPT_STREAM_WINDOW, OPT_ADAPTIVE, OPT_RETRIES, OPT_BREAKER, OPT_NO_COMPRESSION, OPT_BATCH, OPT_NO_PREFLIGHT, OPT_NO_PROBE, OPT_CLASSES, OPT_FIRST_HIT, OPT_DEDUP, OPT_HOST_CAP, OPT_STATS_FILE, OPT_TIMINGS, OPT_TIMINGS_FILE, OPT_SHARD, OPT_URL_WINDOW, OPT_CHECKPOINT, OPT_RESUME, OPT_FORMAT, OPT_DETECT_THREADS };
+    static const struct option long_options[] = {
+        {"url", required_argument, NULL, 'u'},
+        {"list", required_argument, NULL, 'l'},
+        {"payloads", required_argument, NULL, 'p'},
+        {"threads", required_argument, NULL, 't'},
+        {"concurrency", required_argument, NULL, 'c'},
+        {"timeout", required_argument, NULL, 'T'},
+        {"output", required_argument, NULL, 'o'},
+        {"verbose", no_argument, NULL, 'v'},
+        {"version", no_argument, NULL, 'V'},
+        {"help", no_argument, NULL, 'h'},
+        {"no-keepalive", no_argument, NULL, OPT_NO_KEEPALIVE},
+        {"no-compression", no_argument, NULL, OPT_NO_COMPRESSION},
+        {"http2", no_argument, NULL, OPT_HTTP2},
+        {"h2-streams", required_argument, NULL, OPT_H2_STREAMS},
+        {"stream-window", required_argument, NULL, OPT_STREAM_WINDOW},
+        {"adaptive", no_argument, NULL, OPT_ADAPTIVE},
+        {"host-cap", required_argument, NULL, OPT_HOST_CAP},
+        {"retries", required_argument, NULL, OPT_RETRIES},
+        {"breaker", required_argument, NULL, OPT_BREAKER},
+        {"batch", required_argument, NULL, OPT_BATCH},
+        {"no-preflight", no_argument, NULL, OPT_NO_PREFLIGHT},
+        {"no-probe", no_argument, NULL, OPT_NO_PROBE},
+        {"classes", no_argument, NULL, OPT_CLASSES},
+        {"first-hit", no_argument, NULL, OPT_FIRST_HIT},
+        {"dedup", no_argument, NULL, OPT_DEDUP},
+        {"stats-file", required_argument, NULL, OPT_STATS_FILE},
+        {"timings", no_argument, NULL, OPT_TIMINGS},
+        {"timings-file", required_argument, NULL, OPT_TIMINGS_FILE},
+        {"shard", required_argument, NULL, OPT_SHARD},
+        {"url-window", required_argument, NULL, OPT_URL_WINDOW},
+        {"checkpoint", required_argument, NULL, OPT_CHECKPOINT},
+        {"resume", no_argument, NULL, OPT_RESUME},
+        {"format", required_argument, NULL, OPT_FORMAT},
+        {"detect-threads", required_argument, NULL, OPT_DETECT_THREADS},
+        {NULL, 0, NULL, 0},
+    };
+
+    while ((opt = getopt_long(argc, argv, "u:l:p:t:c:T:o:vVh", long_options, NULL)) != -1) {
         switch (opt) {
             case 'u': single_url = optarg; break;
             case 'l': url_file = optarg; break;
             case 'p': payload_file = optarg; break;
             case 't': config.threads = atoi(optarg); break;
+            case 'c': config.concurrency = atoi(optarg); break;
             case 'T': config.timeout = atoi(optarg); break;
             case 'o': config.output_file = optarg; break;
             case 'v': config.verbose = true; break;
+            case OPT_NO_KEEPALIVE: config.keepalive = false; break;
+            case OPT_NO_COMPRESSION: config.compression = false; break;
+            case OPT_HTTP2: config.http2 = true; break;
+            case OPT_H2_STREAMS: config.h2_streams = atoi(optarg); break;
+            case OPT_STREAM_WINDOW: config.stream_window = (size_t)strtoul(optarg, NULL, 10) * 1024; break;
+            case OPT_ADAPTIVE: config.adaptive = true; break;
+            case OPT_HOST_CAP: config.host_cap = atoi(optarg); break;
+            case OPT_RETRIES: config.retries = atoi(optarg); break;
+            case OPT_BREAKER: config.breaker = atoi(optarg); break;
+            case OPT_BATCH: config.batch = atoi(optarg); break;
+            case OPT_NO_PREFLIGHT: config.preflight = false; break;
+            case OPT_NO_PROBE: config.probe = false; break;
+            case OPT_CLASSES: config.classes = true; break;
+            case OPT_FIRST_HIT: config.first_hit = true; break;
+            case OPT_DEDUP: config.dedup = true; break;
+            case OPT_STATS_FILE: config.stats_file = optarg; break;
+            case OPT_TIMINGS: config.timings = true; break;
+            case OPT_TIMINGS_FILE: config.timings_file = optarg; break;
+            case OPT_URL_WINDOW: config.url_window = atoi(optarg); break;
+            case OPT_CHECKPOINT: config.checkpoint_file = optarg; break;
+            case OPT_RESUME: config.resume = true; break;
+            case OPT_DETECT_THREADS: config.detect_threads = atoi(optarg); break;
+            case OPT_FORMAT:
+                if (strcmp(optarg, "plain") != 0 && strcmp(optarg, "jsonl") != 0) {
+                    fprintf(stderr, "\033[91m[✗]\033[0m invalid format %s, expected plain or jsonl\n", optarg);
+                    return 1;
+                }
+                config.jsonl = strcmp(optarg, "jsonl") == 0;
+                break;
+            case OPT_SHARD:
+                if (!shard_parse(optarg, &config.shard_index, &config.shard_count)) {
+                    fprintf(stderr, "\033[91m[✗]\033[0m invalid shard %s, expected I/N with 1 <= I <= N\n", optarg);
+                    return 1;
+                }
+                break;
             case 'V': print_version(); return 0;
             case 'h': print_help(); return 0;
             default: print_help(); return 1;
@@ -88,6 +240,8 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "\033[91m[✗]\033[0m failed to load payloads from %s\n", payload_file);
         return 1;
     }
+    history_load(&config);
+    payload_classes_init(&config);
 
     if (single_url) {
         if (strchr(single_url, '#')) {
@@ -98,9 +252,9 @@ int main(int argc, char *argv[]) {
         config.urls[0] = strdup(single_url);
         config.url_count = 1;
     } else {
-        config.urls = load_file_lines(url_file, &config.url_count);
-        if (!config.urls || config.url_count == 0) {
-            fprintf(stderr, "\033[91m[✗]\033[0m failed to load URLs from %s\n", url_file);
+        config.url_stream = url_stream_open(url_file);
+        if (!config.url_stream) {
+            fprintf(stderr, "\033[91m[✗]\033[0m failed to open URLs from %s\n", url_file);
             free_lines(config.payloads, config.payload_count);
             return 1;
         }
@@ -108,14 +262,59 @@ int main(int argc, char *argv[]) {
 
     if (config.threads < 1) config.threads = 1;
     if (config.threads > 100) config.threads = 100;
+    if (config.concurrency < 0) config.concurrency = 0;
+    if (config.concurrency > MAX_CONCURRENCY) config.concurrency = MAX_CONCURRENCY;
+    if (config.h2_streams < 1) config.h2_streams = 1;
+    if (config.host_cap < 0) config.host_cap = 0;
+    if (config.retries < 0) config.retries = 0;
+    if (config.breaker < 0) config.breaker = 0;
+    if (config.batch < 1) config.batch = 1;
+    if (config.batch > MAX_BATCH) config.batch = MAX_BATCH;
+    if (config.url_window < 1) config.url_window = 1;
+    if (config.detect_threads < 0) config.detect_threads = detect_default_threads();
+    if (config.timings_file) config.timings = true;
+    if (config.http2 && config.concurrency == 0) config.concurrency = config.h2_streams;
+    if (config.resume && !config.checkpoint_file) {
+        fprintf(stderr, "\033[91m[✗]\033[0m --resume needs --checkpoint FILE\n");
+        return 1;
+    }
+    if (!checkpoint_open(&config)) return 1;
 
-    printf("\n\033[36m[i]\033[0m loaded %d URLs, %d payloads, %d threads\n\n",
-           config.url_count, config.payload_count, config.threads);
+    char urls_desc[64];
+    if (config.url_stream) {
+        snprintf(urls_desc, sizeof(urls_desc), "streaming URLs from %s", strcmp(url_file, "-") == 0 ? "stdin" : "file");
+    } else {
+        snprintf(urls_desc, sizeof(urls_desc), "loaded %d URLs", config.url_count);
+    }
+    if (config.concurrency > 0) {
+        printf("\n\033[36m[i]\033[0m %s, %d payloads, %d threads, %d in flight\n\n",
+               urls_desc, config.payload_count, config.threads, config.concurrency);
+    } else {
+        printf("\n\033[36m[i]\033[0m %s, %d payloads, %d threads\n\n",
+               urls_desc, config.payload_count, config.threads);
+    }
 
+    if (!writer_start(&config)) return 1;
     run_scan(&config);
+    if (!history_save(&config)) {
+        fprintf(stderr, "\033[33m[!]\033[0m failed to write payload stats to %s\n", config.stats_file);
+    }
 
     free_lines(config.urls, config.url_count);
+    url_stream_close(config.url_stream);
+    checkpoint_close(&config);
+    free(config.url_blocked);
+    free(config.payload_needs);
+    free(config.payload_class);
+    free(config.class_state);
+    free(config.url_point);
+    free(config.found_set);
+    free(config.url_hash);
+    free(config.payload_hash);
+    history_free(&config);
     free_lines(config.payloads, config.payload_count);
+    hosts_cleanup();
+    http_share_cleanup();
     curl_global_cleanup();
 
     return 0;
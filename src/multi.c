@@ -0,0 +1,526 @@
+#include "xssmap.h"
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_EVENTS 256
+#define PARKED_POLL_MS 10
+
+typedef struct multi_loop multi_loop_t;
+
+struct multi_engine {
+    config_t *config;
+    scan_result_t *result;
+    pthread_t *threads;
+    multi_loop_t *loops;
+    int loop_count;
+    int started;
+    int warm;
+};
+
+typedef struct {
+    CURL *easy;
+    response_t *resp;
+    char *test_url;
+    host_t *host;
+    detect_job_t *job;
+    int url_idx;
+    int payload_idx;
+    int batch;
+    int attempt;
+    long retry_at;
+    bool running;
+} multi_slot_t;
+
+typedef struct {
+    int url_idx;
+    int payload_idx;
+    long expires;
+} task_ref_t;
+
+typedef enum {
+    SLOT_READY,
+    SLOT_WAIT,
+    SLOT_EXHAUSTED
+} slot_state_t;
+
+struct multi_loop {
+    multi_engine_t *engine;
+    url_window_t *window;
+    long seq;
+    buffer_pool_t pool;
+    int slots;
+    int epfd;
+    long deadline;
+    task_ref_t *deferred;
+    int deferred_count;
+    int deferred_cap;
+    int deferred_pos;
+    task_ref_t *confirm;
+    int confirm_count;
+    int confirm_cap;
+    detect_inbox_t *inbox;
+    scan_result_t local;
+};
+
+static bool claim_task(config_t *config, url_window_t *window, int *url_idx, int *payload_idx, int *count) {
+    int limit;
+    pthread_mutex_lock(&window->lock);
+    for (;;) {
+        if (window->next_task >= schedule_total(window)) {
+            pthread_mutex_unlock(&window->lock);
+            return false;
+        }
+        if (!schedule_task(config, window, window->next_task, url_idx, payload_idx, &limit)) {
+            window->next_task++;
+            continue;
+        }
+
+        if (*payload_idx == 0) writer_text(config, "\033[36m→\033[0m %s\n", config->urls[*url_idx]);
+
+        if (!payload_pruned(config, *url_idx, *payload_idx)) break;
+        checkpoint_mark(config, *url_idx, *payload_idx);
+        window->next_task++;
+    }
+
+    *count = batch_span(config, *url_idx, *payload_idx, limit);
+    window->next_task += *count;
+    window_hold(window, *count);
+    pthread_mutex_unlock(&window->lock);
+    return true;
+}
+
+static bool next_task(multi_loop_t *loop, int *url_idx, int *payload_idx, int *count) {
+    config_t *config = loop->engine->config;
+
+    for (;;) {
+        if (!loop->window) loop->window = feed_next(config, loop->seq, false);
+        if (!loop->window) return false;
+        if (claim_task(config, loop->window, url_idx, payload_idx, count)) return true;
+
+        loop->seq = loop->window->seq + 1;
+        window_leave(config, loop->window);
+        loop->window = NULL;
+    }
+}
+
+static int socket_callback(CURL *easy, curl_socket_t s, int what, void *userp, void *socketp) {
+    (void)easy;
+    (void)socketp;
+    multi_loop_t *loop = (multi_loop_t *)userp;
+
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(loop->epfd, EPOLL_CTL_DEL, s, NULL);
+        return 0;
+    }
+
+    struct epoll_event ev = {0};
+    ev.data.fd = s;
+    if (what & CURL_POLL_IN) ev.events |= EPOLLIN;
+    if (what & CURL_POLL_OUT) ev.events |= EPOLLOUT;
+
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_MOD, s, &ev) != 0 && errno == ENOENT) {
+        epoll_ctl(loop->epfd, EPOLL_CTL_ADD, s, &ev);
+    }
+    return 0;
+}
+
+static int timer_callback(CURLM *multi, long timeout_ms, void *userp) {
+    (void)multi;
+    multi_loop_t *loop = (multi_loop_t *)userp;
+    loop->deadline = timeout_ms < 0 ? -1 : monotonic_ms() + timeout_ms;
+    return 0;
+}
+
+static void push_confirm(multi_loop_t *loop, int url_idx, int payload_idx) {
+    if (loop->confirm_count >= loop->confirm_cap) {
+        loop->confirm_cap = loop->confirm_cap ? loop->confirm_cap * 2 : 64;
+        loop->confirm = realloc(loop->confirm, loop->confirm_cap * sizeof(task_ref_t));
+    }
+    loop->confirm[loop->confirm_count].url_idx = url_idx;
+    loop->confirm[loop->confirm_count].payload_idx = payload_idx;
+    loop->confirm[loop->confirm_count].expires = 0;
+    loop->confirm_count++;
+}
+
+static void defer_task(multi_loop_t *loop, int url_idx, int payload_idx) {
+    if (loop->deferred_count >= loop->deferred_cap) {
+        loop->deferred_cap = loop->deferred_cap ? loop->deferred_cap * 2 : 64;
+        loop->deferred = realloc(loop->deferred, loop->deferred_cap * sizeof(task_ref_t));
+    }
+    loop->deferred[loop->deferred_count].url_idx = url_idx;
+    loop->deferred[loop->deferred_count].payload_idx = payload_idx;
+    loop->deferred[loop->deferred_count].expires = monotonic_ms() + 2 * BREAKER_COOLDOWN_MS;
+    loop->deferred_count++;
+    loop->local.deferred++;
+}
+
+static bool take_task(multi_loop_t *loop, int *url_idx, int *payload_idx, int *count, long *expires) {
+    *expires = 0;
+    *count = 1;
+    if (loop->confirm_count > 0) {
+        loop->confirm_count--;
+        *url_idx = loop->confirm[loop->confirm_count].url_idx;
+        *payload_idx = loop->confirm[loop->confirm_count].payload_idx;
+        return true;
+    }
+    if (next_task(loop, url_idx, payload_idx, count)) return true;
+    if (loop->deferred_pos >= loop->deferred_count) {
+        loop->deferred_pos = 0;
+        loop->deferred_count = 0;
+        return false;
+    }
+
+    *url_idx = loop->deferred[loop->deferred_pos].url_idx;
+    *payload_idx = loop->deferred[loop->deferred_pos].payload_idx;
+    *expires = loop->deferred[loop->deferred_pos].expires;
+    loop->deferred_pos++;
+    return true;
+}
+
+static const char *slot_payload(config_t *config, multi_slot_t *slot) {
+    return slot->batch > 1 ? NULL : config->payloads[slot->payload_idx];
+}
+
+static slot_state_t prepare_slot(multi_loop_t *loop, multi_slot_t *slot) {
+    config_t *config = loop->engine->config;
+    long expires;
+
+    while (take_task(loop, &slot->url_idx, &slot->payload_idx, &slot->batch, &expires)) {
+        if (found_set_contains(config, slot->url_idx)) {
+            loop->local.first_hit_skipped += slot->batch;
+            checkpoint_skip(config, slot->url_idx, slot->payload_idx, slot->batch);
+            window_release(config, slot->url_idx, slot->batch);
+            continue;
+        }
+        if (slot->batch == 1 && class_settled(config, slot->url_idx, slot->payload_idx)) {
+            loop->local.class_skipped++;
+            checkpoint_mark(config, slot->url_idx, slot->payload_idx);
+            window_release(config, slot->url_idx, 1);
+            continue;
+        }
+        url_window_t *window = window_of(config, slot->url_idx);
+        slot->host = window->hosts ? window->hosts[slot->url_idx - window->base] : NULL;
+
+        if (slot->host && config->breaker > 0 && !host_breaker_allow(slot->host)) {
+            if (expires == 0) {
+                for (int i = 0; i < slot->batch; i++) defer_task(loop, slot->url_idx, slot->payload_idx + i);
+            } else if (host_seen_alive(slot->host) && monotonic_ms() < expires) {
+                loop->deferred_pos--;
+                slot->host = NULL;
+                return SLOT_WAIT;
+            } else {
+                loop->local.skipped++;
+                checkpoint_mark(config, slot->url_idx, slot->payload_idx);
+                window_release(config, slot->url_idx, 1);
+            }
+            continue;
+        }
+
+        const char *url = config->urls[slot->url_idx];
+        const char *payload = slot_payload(config, slot);
+        slot->test_url = slot->batch > 1 ? inject_batch(url, &config->payloads[slot->payload_idx], slot->batch)
+                                         : inject_payload(url, payload);
+        slot->resp = http_prepare(slot->easy, &loop->pool, slot->test_url, payload, config);
+        slot->attempt = 0;
+        slot->retry_at = 0;
+
+        if (slot->resp) return SLOT_READY;
+
+        detect_job_t *job = detect_job_new(NULL, NULL, slot->test_url, slot->host, slot->url_idx,
+                                           slot->payload_idx, slot->batch);
+        slot->test_url = NULL;
+        if (!detect_try_submit(config, loop->inbox, job)) {
+            slot->job = job;
+            slot->host = NULL;
+            return SLOT_WAIT;
+        }
+    }
+    slot->host = NULL;
+    return SLOT_EXHAUSTED;
+}
+
+static bool start_slot(multi_loop_t *loop, CURLM *multi, multi_slot_t *slot) {
+    config_t *config = loop->engine->config;
+
+    if (slot->retry_at > monotonic_ms()) return false;
+    if (slot->host && config->host_cap > 0 && !host_try_enter(slot->host, config->host_cap)) return false;
+    if (slot->host && config->adaptive && !host_try_acquire(slot->host, config->concurrency)) {
+        if (config->host_cap > 0) host_leave(slot->host);
+        return false;
+    }
+
+    curl_multi_add_handle(multi, slot->easy);
+    slot->running = true;
+    return true;
+}
+
+static bool retry_slot(multi_loop_t *loop, multi_slot_t *slot, CURLcode res, http_stats_t *stats) {
+    config_t *config = loop->engine->config;
+
+    if (slot->attempt >= config->retries || !http_should_retry(slot->easy, res)) return false;
+    if (slot->host && config->breaker > 0 && host_breaker_open(slot->host)) return false;
+
+    response_t *resp = http_prepare(slot->easy, &loop->pool, slot->test_url, slot_payload(config, slot), config);
+    if (!resp) return false;
+
+    free_response(slot->resp);
+    slot->resp = resp;
+    slot->retry_at = monotonic_ms() + http_retry_delay_ms(slot->easy, slot->attempt);
+    slot->attempt++;
+    slot->running = false;
+    stats->retries++;
+    return true;
+}
+
+static bool finish_slot(multi_loop_t *loop, CURLM *multi, multi_slot_t *slot,
+                        CURLcode res, http_stats_t *stats) {
+    config_t *config = loop->engine->config;
+
+    res = http_complete(stats, slot->easy, slot->resp, res);
+    if (slot->host && config->timings) timing_record_host(slot->host, slot->easy);
+    if (slot->host && config->host_cap > 0) host_leave(slot->host);
+    if (slot->host && config->adaptive) {
+        double latency_ms;
+        host_outcome_t outcome = http_outcome(slot->easy, res, &latency_ms);
+        host_release(slot->host, latency_ms, outcome);
+    }
+    if (slot->host && config->breaker > 0) {
+        host_breaker_record(slot->host, http_host_failure(slot->easy, res), config->breaker);
+    }
+    curl_multi_remove_handle(multi, slot->easy);
+
+    if (retry_slot(loop, slot, res, stats)) return false;
+
+    response_t *resp = slot->resp;
+    if (res != CURLE_OK) {
+        free_response(resp);
+        resp = NULL;
+    }
+
+    detect_job_t *job = detect_job_new(slot->easy, resp, slot->test_url, slot->host, slot->url_idx,
+                                       slot->payload_idx, slot->batch);
+    if (!detect_try_submit(config, loop->inbox, job)) slot->job = job;
+    slot->resp = NULL;
+    slot->test_url = NULL;
+    slot->host = NULL;
+    slot->running = false;
+    return true;
+}
+
+static void finish_jobs(multi_loop_t *loop, detect_job_t *jobs) {
+    config_t *config = loop->engine->config;
+
+    while (jobs) {
+        detect_job_t *job = jobs;
+        jobs = job->next;
+
+        if (job->batch > 1) {
+            int confirm[MAX_BATCH];
+            int candidates = scan_process_batch(config, &loop->local, job, confirm);
+            for (int i = 0; i < candidates; i++) push_confirm(loop, job->url_idx, confirm[i]);
+            window_release(config, job->url_idx, job->batch - candidates);
+        } else {
+            bool found = scan_process_response(config, &loop->local, job);
+            class_record(config, job->url_idx, job->payload_idx, found, job->status);
+            if (found) {
+                found_set_insert(config, job->url_idx);
+            } else {
+                checkpoint_mark(config, job->url_idx, job->payload_idx);
+            }
+            window_release(config, job->url_idx, 1);
+        }
+        detect_job_free(job);
+    }
+}
+
+static void *multi_worker(void *arg) {
+    multi_loop_t *loop = (multi_loop_t *)arg;
+    config_t *config = loop->engine->config;
+
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    loop->deadline = -1;
+    CURLM *multi = loop->epfd < 0 ? NULL : curl_multi_init();
+    if (!multi) {
+        fprintf(stderr, "\033[91m[✗]\033[0m event loop could not start (%s), stopping\n",
+                loop->epfd < 0 ? strerror(errno) : "curl_multi_init failed");
+        if (loop->epfd >= 0) close(loop->epfd);
+        feed_stop(config);
+        return NULL;
+    }
+    loop->inbox = detect_inbox_new();
+
+    curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, socket_callback);
+    curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, loop);
+    curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, timer_callback);
+    curl_multi_setopt(multi, CURLMOPT_TIMERDATA, loop);
+    int warm = loop->engine->warm < loop->slots ? loop->engine->warm : loop->slots;
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)(loop->slots + warm));
+    if (config->http2) {
+        curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(multi, CURLMOPT_MAX_CONCURRENT_STREAMS, (long)config->h2_streams);
+    }
+
+    struct curl_slist *headers = http_default_headers(config->keepalive);
+    multi_slot_t *slots = calloc(loop->slots, sizeof(multi_slot_t));
+    for (int i = 0; i < loop->slots; i++) {
+        slots[i].easy = curl_easy_init();
+        http_setup_handle(slots[i].easy, headers, config);
+        curl_easy_setopt(slots[i].easy, CURLOPT_PRIVATE, &slots[i]);
+    }
+
+    http_stats_t stats = {0};
+    buffer_pool_init(&loop->pool, &stats);
+    struct epoll_event events[MAX_EVENTS];
+    int active = 0;
+    int parked = 0;
+
+    for (;;) {
+        finish_jobs(loop, detect_take(loop->inbox, false));
+
+        bool exhausted = false;
+        bool waiting = false;
+        bool full = detect_full(config);
+        for (int i = 0; i < loop->slots; i++) {
+            multi_slot_t *slot = &slots[i];
+            if (slot->running) continue;
+
+            if (slot->job) {
+                if (full || !detect_try_submit(config, loop->inbox, slot->job)) {
+                    full = true;
+                    continue;
+                }
+                slot->job = NULL;
+            }
+            if (full) continue;
+            if (!slot->test_url) {
+                if ((exhausted && loop->confirm_count == 0) || waiting) continue;
+                slot_state_t state = prepare_slot(loop, slot);
+                if (state == SLOT_EXHAUSTED) exhausted = true;
+                if (state == SLOT_WAIT) waiting = true;
+                if (state != SLOT_READY) continue;
+                parked++;
+            }
+
+            if (start_slot(loop, multi, slot)) {
+                parked--;
+                active++;
+            }
+        }
+        if (active == 0 && parked == 0 && !waiting && !full) {
+            if (detect_pending(loop->inbox) > 0) {
+                finish_jobs(loop, detect_take(loop->inbox, true));
+                continue;
+            }
+            if (loop->confirm_count > 0) continue;
+
+            loop->window = feed_next(config, loop->seq, true);
+            if (!loop->window) break;
+            continue;
+        }
+
+        int wait_ms = parked > 0 || waiting || full || exhausted || detect_pending(loop->inbox) > 0 ? PARKED_POLL_MS : 1000;
+        if (loop->deadline >= 0) {
+            long remaining = loop->deadline - monotonic_ms();
+            if (remaining < wait_ms) wait_ms = remaining < 0 ? 0 : (int)remaining;
+        }
+
+        int running = 0;
+        int nfds = epoll_wait(loop->epfd, events, MAX_EVENTS, wait_ms);
+        for (int i = 0; i < nfds; i++) {
+            int flags = 0;
+            if (events[i].events & EPOLLIN) flags |= CURL_CSELECT_IN;
+            if (events[i].events & EPOLLOUT) flags |= CURL_CSELECT_OUT;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) flags |= CURL_CSELECT_ERR;
+            curl_multi_socket_action(multi, events[i].data.fd, flags, &running);
+        }
+
+        if (loop->deadline >= 0 && monotonic_ms() >= loop->deadline) {
+            loop->deadline = -1;
+            curl_multi_socket_action(multi, CURL_SOCKET_TIMEOUT, 0, &running);
+        }
+
+        CURLMsg *msg;
+        int pending;
+        while ((msg = curl_multi_info_read(multi, &pending))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            multi_slot_t *slot = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&slot);
+            active--;
+            if (!finish_slot(loop, multi, slot, msg->data.result, &stats)) parked++;
+        }
+    }
+
+    http_stats_merge(&loop->local.http, &stats);
+
+    pthread_mutex_lock(&loop->engine->result->mutex);
+    scan_result_merge(loop->engine->result, &loop->local);
+    pthread_mutex_unlock(&loop->engine->result->mutex);
+
+    for (int i = 0; i < loop->slots; i++) {
+        free_response(slots[i].resp);
+        free(slots[i].test_url);
+        curl_easy_cleanup(slots[i].easy);
+    }
+    free(slots);
+    free(loop->deferred);
+    free(loop->confirm);
+    detect_inbox_free(loop->inbox);
+    buffer_pool_destroy(&loop->pool);
+    curl_slist_free_all(headers);
+    curl_multi_cleanup(multi);
+    close(loop->epfd);
+    return NULL;
+}
+
+static void raise_fd_limit(int wanted) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0) return;
+    if (rl.rlim_cur >= (rlim_t)wanted) return;
+
+    rl.rlim_cur = (rl.rlim_max == RLIM_INFINITY || rl.rlim_max >= (rlim_t)wanted) ? (rlim_t)wanted : rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+}
+
+multi_engine_t *multi_start(config_t *config, scan_result_t *result) {
+    multi_engine_t *engine = calloc(1, sizeof(multi_engine_t));
+    engine->config = config;
+    engine->result = result;
+
+    int loops = config->threads;
+    if (loops > config->concurrency) loops = config->concurrency;
+    if (loops < 1 || config->http2) loops = 1;
+
+    raise_fd_limit(config->concurrency * 2 + 64);
+
+    engine->loop_count = loops;
+    engine->warm = config->host_groups;
+    engine->threads = malloc(loops * sizeof(pthread_t));
+    engine->loops = calloc(loops, sizeof(multi_loop_t));
+
+    for (int t = 0; t < loops; t++) {
+        engine->loops[t].engine = engine;
+        engine->loops[t].slots = config->concurrency / loops + (t < config->concurrency % loops ? 1 : 0);
+        if (pthread_create(&engine->threads[t], NULL, multi_worker, &engine->loops[t]) != 0) {
+            fprintf(stderr, "\033[91m[✗]\033[0m could not start event loop %d, stopping\n", t);
+            feed_stop(config);
+            break;
+        }
+        engine->started++;
+    }
+    return engine;
+}
+
+void multi_stop(multi_engine_t *engine) {
+    if (!engine) return;
+
+    for (int t = 0; t < engine->started; t++) {
+        pthread_join(engine->threads[t], NULL);
+    }
+    free(engine->loops);
+    free(engine->threads);
+    free(engine);
+}
@@ -0,0 +1,200 @@
+#include "xssmap.h"
+
+typedef struct {
+    config_t *config;
+    scan_result_t *result;
+    url_window_t *window;
+    pthread_mutex_t lock;
+    int next_url;
+    char (*canaries)[PREFLIGHT_CANARY_LEN + 1];
+    int *reflections;
+    int *pruned;
+} preflight_t;
+
+static void make_canary(char *canary) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    memcpy(canary, "xsm", 3);
+    for (int i = 3; i < PREFLIGHT_CANARY_LEN; i++) {
+        canary[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+    canary[PREFLIGHT_CANARY_LEN] = '\0';
+}
+
+static int count_reflections(const response_t *resp, const char *canary) {
+    if (!resp || !resp->data) return 0;
+
+    int count = 0;
+    const char *p = resp->data;
+    while ((p = strstr(p, canary))) {
+        count++;
+        p += PREFLIGHT_CANARY_LEN;
+    }
+    return count;
+}
+
+static char *build_probe(const char *canary) {
+    char *probe = malloc(PROBE_TOKENS * (2 * PREFLIGHT_CANARY_LEN + 16) + 1);
+    char *p = probe;
+    for (int t = 0; t < PROBE_TOKENS; t++) {
+        p += sprintf(p, "%s%d%s%s%d", canary, t, probe_tokens[t], canary, t);
+    }
+    return probe;
+}
+
+static unsigned probe_blocked(const response_t *resp, const char *canary) {
+    if (!resp || !resp->data) return 0;
+
+    char marker[2 * PREFLIGHT_CANARY_LEN + 16];
+    unsigned blocked = 0;
+    bool seen = false;
+    for (int t = 0; t < PROBE_TOKENS; t++) {
+        snprintf(marker, sizeof(marker), "%s%d", canary, t);
+        if (strstr(resp->data, marker)) seen = true;
+
+        snprintf(marker, sizeof(marker), "%s%d%s%s%d", canary, t, probe_tokens[t], canary, t);
+        if (!strstr(resp->data, marker)) blocked |= 1u << t;
+    }
+    return seen ? blocked : 0;
+}
+
+static void probe_url(preflight_t *pf, http_client_t *client, int i) {
+    config_t *config = pf->config;
+    int u = pf->window->base + i;
+    char *probe = build_probe(pf->canaries[i]);
+    char *test_url = inject_payload(config->urls[u], probe);
+
+    response_t *resp = http_client_get(client, test_url, NULL);
+    unsigned blocked = probe_blocked(resp, pf->canaries[i]);
+    config->url_blocked[u] = blocked;
+
+    int pruned = 0;
+    for (int p = 0; blocked && p < config->payload_count; p++) {
+        if (config->payload_needs[p] & blocked) pruned++;
+    }
+    pf->pruned[i] = pruned;
+
+    if (config->verbose && pruned > 0) {
+        char tokens[64] = "";
+        for (int t = 0; t < PROBE_TOKENS; t++) {
+            if (blocked & (1u << t)) {
+                strcat(tokens, " ");
+                strcat(tokens, probe_tokens[t]);
+            }
+        }
+        writer_text(config, "\033[36m[i]\033[0m \033[90mpruned %d/%d payloads, encoded:%s %s\033[0m\n",
+                    pruned, config->payload_count, tokens, config->urls[u]);
+    }
+
+    free_response(resp);
+    free(test_url);
+    free(probe);
+}
+
+static void reflect_url(preflight_t *pf, http_client_t *client, int i) {
+    config_t *config = pf->config;
+    int u = pf->window->base + i;
+    char *test_url = inject_payload(config->urls[u], pf->canaries[i]);
+    response_t *resp = http_client_get(client, test_url, NULL);
+    pf->reflections[i] = resp ? count_reflections(resp, pf->canaries[i]) : -1;
+
+    if (config->verbose) {
+        if (pf->reflections[i] < 0) {
+            writer_text(config, "\033[33m[!]\033[0m \033[90mpreflight failed, keeping %s\033[0m\n", config->urls[u]);
+        } else if (pf->reflections[i] == 0) {
+            writer_text(config, "\033[91m[✗]\033[0m \033[90mno reflection %s\033[0m\n", config->urls[u]);
+        } else {
+            writer_text(config, "\033[36m[i]\033[0m \033[90mreflects %dx %s\033[0m\n", pf->reflections[i], config->urls[u]);
+        }
+    }
+
+    free_response(resp);
+    free(test_url);
+}
+
+static bool wants_probe(const config_t *config, int reflections) {
+    return config->probe && (!config->preflight || reflections > 0);
+}
+
+static void *preflight_worker(void *arg) {
+    preflight_t *pf = (preflight_t *)arg;
+    config_t *config = pf->config;
+
+    http_client_t client;
+    if (!http_client_init(&client, config)) return NULL;
+
+    for (;;) {
+        pthread_mutex_lock(&pf->lock);
+        int i = pf->next_url++;
+        pthread_mutex_unlock(&pf->lock);
+        if (i >= pf->window->count) break;
+
+        pf->reflections[i] = -1;
+        if (config->preflight) reflect_url(pf, &client, i);
+        if (wants_probe(config, pf->reflections[i])) probe_url(pf, &client, i);
+    }
+
+    pthread_mutex_lock(&pf->result->mutex);
+    http_stats_merge(&pf->result->http, &client.stats);
+    pthread_mutex_unlock(&pf->result->mutex);
+
+    http_client_cleanup(&client);
+    return NULL;
+}
+
+void run_preflight(config_t *config, scan_result_t *result, url_window_t *window) {
+    int count = window->count;
+    preflight_t pf = {
+        .config = config,
+        .result = result,
+        .window = window,
+        .next_url = 0,
+        .canaries = malloc(count * sizeof(*pf.canaries)),
+        .reflections = calloc(count, sizeof(int)),
+        .pruned = calloc(count, sizeof(int)),
+    };
+    pthread_mutex_init(&pf.lock, NULL);
+
+    for (int i = 0; i < count; i++) make_canary(pf.canaries[i]);
+
+    if (config->probe && !config->url_blocked) config->url_blocked = malloc(config->url_slots * sizeof(unsigned));
+    if (config->url_blocked) memset(&config->url_blocked[window->base], 0, count * sizeof(unsigned));
+
+    int workers = config->concurrency > config->threads ? config->concurrency : config->threads;
+    if (workers > PREFLIGHT_MAX_WORKERS) workers = PREFLIGHT_MAX_WORKERS;
+    if (workers > count) workers = count;
+
+    pthread_t *threads = malloc(workers * sizeof(pthread_t));
+    for (int t = 0; t < workers; t++) {
+        pthread_create(&threads[t], NULL, preflight_worker, &pf);
+    }
+    for (int t = 0; t < workers; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    int kept = window->base;
+    for (int i = 0; i < count; i++) {
+        int u = window->base + i;
+        if (pf.reflections[i] == 0) {
+            free(config->urls[u]);
+            continue;
+        }
+        if (config->url_blocked) config->url_blocked[kept] = config->url_blocked[u];
+        if (config->url_origin) config->url_origin[kept] = config->url_origin[u];
+        result->pruned += pf.pruned[i];
+        if (pf.pruned[i] > 0) result->probe_pruned_urls++;
+        if (wants_probe(config, pf.reflections[i])) result->probe_requests++;
+        config->urls[kept++] = config->urls[u];
+    }
+    window->count = kept - window->base;
+
+    if (config->preflight) {
+        result->preflight_dropped += count - window->count;
+        result->preflight_requests += count;
+    }
+
+    free(threads);
+    free(pf.canaries);
+    free(pf.reflections);
+    free(pf.pruned);
+    pthread_mutex_destroy(&pf.lock);
+}
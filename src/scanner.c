@@ -2,128 +2,802 @@
 #include "techniques/techniques.h"
 #include <time.h>
 
+struct task_range {
+    pthread_mutex_t lock;
+    long next;
+    long end;
+};
+
 typedef struct {
     config_t *config;
     scan_result_t *result;
+    int workers;
+    int started;
+    pthread_t *threads;
+    struct pool_worker *args;
+} task_pool_t;
+
+typedef struct pool_worker {
+    task_pool_t *pool;
+    int id;
+} pool_worker_t;
+
+typedef struct {
     int url_idx;
-    int payload_start;
-    int payload_end;
-} task_t;
+    int payload_idx;
+    long expires;
+} task_ref_t;
 
-static void *scan_worker(void *arg) {
-    task_t *task = (task_t *)arg;
-    config_t *config = task->config;
-    scan_result_t *result = task->result;
-    
-    const char *url = config->urls[task->url_idx];
+typedef struct {
+    task_ref_t *tasks;
+    int count;
+    int cap;
+} task_list_t;
 
-    for (int i = task->payload_start; i < task->payload_end; i++) {
-        const char *payload = config->payloads[i];
-        char *test_url = inject_payload(url, payload);
+static bool known_clean(config_t *config, detect_job_t *job, const char *payload, uint64_t *fingerprint) {
+    response_t *resp = job->resp;
+    if (!config->dedup || !job->host) return false;
+    if (!ci_find(resp->data, resp->size, payload, strlen(payload))) return false;
 
-        response_t *resp = http_get(test_url, config->timeout);
+    *fingerprint = response_fingerprint(resp->data, resp->size, job->payload_idx);
+    bool seen = host_fingerprint_seen(job->host, *fingerprint);
+    job->dedup = seen ? 1 : -1;
+    return seen;
+}
+
+void scan_result_merge(scan_result_t *dst, scan_result_t *src) {
+    dst->total_scanned += src->total_scanned;
+    dst->failed += src->failed;
+    dst->skipped += src->skipped;
+    dst->deferred += src->deferred;
+    dst->batch_requests += src->batch_requests;
+    dst->batch_payloads += src->batch_payloads;
+    dst->batch_candidates += src->batch_candidates;
+    dst->class_skipped += src->class_skipped;
+    dst->first_hit_skipped += src->first_hit_skipped;
+    dst->dedup_hits += src->dedup_hits;
+    dst->dedup_misses += src->dedup_misses;
+    dst->total_found += src->total_found;
+    http_stats_merge(&dst->http, &src->http);
+}
+
+static void report_finding(config_t *config, const char *payload, const detect_job_t *job) {
+    finding_t finding = {
+        .url = job->test_url,
+        .payload = payload,
+        .reason = job->det.reason,
+        .context = job->det.context,
+        .confidence = job->det.confidence,
+        .status = job->status,
+        .total_ms = job->total_us / 1000.0,
+        .ttfb_ms = job->ttfb_us / 1000.0,
+    };
+    writer_finding(config, job->test_url, finding_record(&finding), job->url_idx, job->payload_idx, false);
+}
 
-        pthread_mutex_lock(&result->mutex);
-        result->total_scanned++;
-        pthread_mutex_unlock(&result->mutex);
+static void record_detect(config_t *config, scan_result_t *result, const detect_job_t *job) {
+    if (job->detect_us < 0) return;
+
+    timing_record(&result->http.timing[PHASE_DETECT], job->detect_us);
+    if (config->timings && job->host) timing_record_host_phase(job->host, PHASE_DETECT, job->detect_us);
+}
+
+static bool tagged_reflection(const response_t *resp, int slot, const char *payload) {
+    char tag[16];
+    snprintf(tag, sizeof(tag), BATCH_TAG, slot);
+    size_t pay_len = strlen(payload);
+    const char *end = resp->data + resp->size;
+
+    for (const char *p = resp->data; (p = ci_find(p, end - p, tag, BATCH_TAG_LEN)); p += BATCH_TAG_LEN) {
+        const char *region = p + BATCH_TAG_LEN;
+        const char *next = ci_find(region, end - region, BATCH_TAG_PREFIX, strlen(BATCH_TAG_PREFIX));
+        if (ci_find(region, (next ? next : end) - region, payload, pay_len)) return true;
+    }
+    return false;
+}
+
+static void detect_batch(config_t *config, detect_job_t *job) {
+    response_t *resp = job->resp;
+    if (!resp) return;
+
+    long started = monotonic_us();
+    for (int i = 0; resp->data && resp->size > 0 && i < job->batch; i++) {
+        const char *payload = config->payloads[job->payload_idx + i];
+        if (!tagged_reflection(resp, i, payload)) continue;
 
-        bool vulnerable = false;
         detection_result_t det_result = {0};
-        
-        if (resp && resp->data && resp->size > 0) {
-            vulnerable = run_all_techniques(resp->data, payload, &det_result);
+        if (run_all_techniques(resp->data, payload, &det_result) && det_result.confidence >= 70) {
+            job->candidates |= 1u << i;
+        }
+    }
+    job->detect_us = monotonic_us() - started;
+}
+
+void scan_detect(config_t *config, detect_job_t *job) {
+    if (job->batch > 1) {
+        detect_batch(config, job);
+        return;
+    }
+
+    const char *payload = config->payloads[job->payload_idx];
+    response_t *resp = job->resp;
+    bool vulnerable = false;
+
+    if (resp && resp->verdict == STREAM_CONFIRMED) {
+        job->det = resp->det;
+        vulnerable = true;
+    } else if (resp && resp->verdict == STREAM_CLEAN) {
+        job->det = resp->det;
+    } else if (resp && resp->verdict == STREAM_UNDECIDED && resp->data && resp->size > 0) {
+        uint64_t fingerprint = 0;
+        long started = monotonic_us();
+        if (!known_clean(config, job, payload, &fingerprint)) {
+            vulnerable = run_all_techniques(resp->data, payload, &job->det);
+            if (job->dedup < 0 && !(vulnerable && job->det.confidence >= 70)) {
+                host_fingerprint_add(job->host, fingerprint);
+            }
         }
+        job->detect_us = monotonic_us() - started;
+    }
+    job->found = vulnerable && job->det.confidence >= 70;
+}
+
+bool scan_process_response(config_t *config, scan_result_t *result, detect_job_t *job) {
+    const char *payload = config->payloads[job->payload_idx];
+    result->total_scanned++;
+    if (!job->resp) result->failed++;
+    if (job->dedup > 0) result->dedup_hits++;
+    if (job->dedup < 0) result->dedup_misses++;
+    record_detect(config, result, job);
+
+    if (job->resp) history_record(config, job->payload_idx, job->found, job->det.context);
+
+    if (job->found) {
+        result->total_found++;
+        report_finding(config, payload, job);
+    } else if (config->verbose) {
+        writer_text(config, "\033[91m[✗]\033[0m \033[90m%s\033[0m\n", job->test_url);
+    }
+    return job->found;
+}
 
-        if (vulnerable && det_result.confidence >= 70) {
-            pthread_mutex_lock(&result->mutex);
-            result->total_found++;
-            result->vulnerable_urls = realloc(result->vulnerable_urls, 
-                                              (result->vulnerable_count + 1) * sizeof(char *));
-            result->vulnerable_urls[result->vulnerable_count++] = strdup(test_url);
+int scan_process_batch(config_t *config, scan_result_t *result, detect_job_t *job, int *confirm) {
+    const char *url = config->urls[job->url_idx];
+    int candidates = 0;
+    int misses = 0;
 
-            printf("\033[32m[✓]\033[0m %s\n", test_url);
-            pthread_mutex_unlock(&result->mutex);
-        } else if (config->verbose) {
-            pthread_mutex_lock(&result->mutex);
-            printf("\033[91m[✗]\033[0m \033[90m%s\033[0m\n", test_url);
-            pthread_mutex_unlock(&result->mutex);
+    for (int i = 0; i < job->batch; i++) {
+        int payload_idx = job->payload_idx + i;
+        if (job->candidates & (1u << i)) {
+            confirm[candidates++] = payload_idx;
+            continue;
         }
+        misses++;
+        if (job->resp) history_record(config, payload_idx, false, CTX_UNKNOWN);
+        checkpoint_mark(config, job->url_idx, payload_idx);
+
+        if (config->verbose) {
+            char *test_url = inject_payload(url, config->payloads[payload_idx]);
+            writer_text(config, "\033[91m[✗]\033[0m \033[90m%s\033[0m\n", test_url);
+            free(test_url);
+        }
+    }
+
+    record_detect(config, result, job);
+
+    result->total_scanned += misses;
+    if (!job->resp) result->failed += misses;
+    result->batch_requests++;
+    result->batch_payloads += job->batch;
+    result->batch_candidates += candidates;
+
+    return candidates;
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static response_t *fetch_with_retries(config_t *config, http_client_t *client, host_t *host,
+                                      const char *test_url, const char *payload) {
+    for (int attempt = 0;; attempt++) {
+        if (host && config->host_cap > 0) host_enter(host, config->host_cap);
+        if (host && config->adaptive) host_acquire(host, config->threads);
+        response_t *resp = http_client_get(client, test_url, payload);
+        CURLcode res = client->last_code;
+        if (host && config->timings) timing_record_host(host, client->curl);
+        if (host && config->host_cap > 0) host_leave(host);
+
+        if (host && config->adaptive) {
+            double latency_ms;
+            host_outcome_t outcome = http_outcome(client->curl, res, &latency_ms);
+            host_release(host, latency_ms, outcome);
+        }
+        if (host && config->breaker > 0) {
+            host_breaker_record(host, http_host_failure(client->curl, res), config->breaker);
+        }
+
+        if (attempt >= config->retries || !http_should_retry(client->curl, res)) return resp;
+        if (host && config->breaker > 0 && host_breaker_open(host)) return resp;
 
         free_response(resp);
-        free(test_url);
+        client->stats.retries++;
+        sleep_ms(http_retry_delay_ms(client->curl, attempt));
     }
+}
 
-    free(task);
-    return NULL;
+static void task_list_push(task_list_t *list, int url_idx, int payload_idx, long expires) {
+    if (list->count == list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 64;
+        list->tasks = realloc(list->tasks, list->cap * sizeof(task_ref_t));
+    }
+    list->tasks[list->count].url_idx = url_idx;
+    list->tasks[list->count].payload_idx = payload_idx;
+    list->tasks[list->count].expires = expires;
+    list->count++;
 }
 
-void run_scan(config_t *config) {
-    time_t start_time = time(NULL);
+static void finish_jobs(config_t *config, scan_result_t *result, detect_job_t *jobs, task_list_t *confirm) {
+    while (jobs) {
+        detect_job_t *job = jobs;
+        jobs = job->next;
 
-    scan_result_t result = {
-        .total_scanned = 0,
-        .total_found = 0,
-        .vulnerable_urls = NULL,
-        .vulnerable_count = 0,
-    };
-    pthread_mutex_init(&result.mutex, NULL);
+        if (job->batch > 1) {
+            int candidates[MAX_BATCH];
+            int count = scan_process_batch(config, result, job, candidates);
+            for (int i = 0; i < count; i++) task_list_push(confirm, job->url_idx, candidates[i], 0);
+            window_release(config, job->url_idx, job->batch - count);
+        } else {
+            bool found = scan_process_response(config, result, job);
+            class_record(config, job->url_idx, job->payload_idx, found, job->status);
+            if (found) {
+                found_set_insert(config, job->url_idx);
+            } else {
+                checkpoint_mark(config, job->url_idx, job->payload_idx);
+            }
+            window_release(config, job->url_idx, 1);
+        }
+        detect_job_free(job);
+    }
+}
 
-    int total_tasks = config->url_count * config->payload_count;
-    int max_threads = config->threads;
-    if (max_threads > total_tasks) max_threads = total_tasks;
+static host_t *task_host(const config_t *config, int url_idx) {
+    if (!config->adaptive && config->breaker <= 0 && config->host_cap <= 0 && !config->timings && !config->dedup) {
+        return NULL;
+    }
+    return host_lookup(config->urls[url_idx]);
+}
 
-    pthread_t *threads = malloc(max_threads * sizeof(pthread_t));
-    int thread_count = 0;
+static void scan_payload(config_t *config, scan_result_t *result, http_client_t *client,
+                         detect_inbox_t *inbox, host_t *host, int url_idx, int payload_idx) {
+    if (found_set_contains(config, url_idx)) {
+        result->first_hit_skipped++;
+        checkpoint_mark(config, url_idx, payload_idx);
+        window_release(config, url_idx, 1);
+        return;
+    }
+    if (class_settled(config, url_idx, payload_idx)) {
+        result->class_skipped++;
+        checkpoint_mark(config, url_idx, payload_idx);
+        window_release(config, url_idx, 1);
+        return;
+    }
 
-    for (int u = 0; u < config->url_count; u++) {
-        printf("\033[36m→\033[0m %s\n", config->urls[u]);
+    const char *payload = config->payloads[payload_idx];
+    char *test_url = inject_payload(config->urls[url_idx], payload);
 
-        int payloads_per_thread = config->payload_count / max_threads;
-        int remainder = config->payload_count % max_threads;
-        int start = 0;
+    response_t *resp = fetch_with_retries(config, client, host, test_url, payload);
+    detect_submit(config, inbox, detect_job_new(client->curl, resp, test_url, host, url_idx, payload_idx, 1));
+}
 
-        thread_count = 0;
-        for (int t = 0; t < max_threads && start < config->payload_count; t++) {
-            int batch = payloads_per_thread + (t < remainder ? 1 : 0);
-            if (batch == 0) break;
+static void scan_batch(config_t *config, scan_result_t *result, http_client_t *client,
+                       detect_inbox_t *inbox, host_t *host, int url_idx, int start, int count) {
+    const char *url = config->urls[url_idx];
+    if (found_set_contains(config, url_idx)) {
+        result->first_hit_skipped += count;
+        checkpoint_skip(config, url_idx, start, count);
+        window_release(config, url_idx, count);
+        return;
+    }
 
-            task_t *task = malloc(sizeof(task_t));
-            task->config = config;
-            task->result = &result;
-            task->url_idx = u;
-            task->payload_start = start;
-            task->payload_end = start + batch;
+    char *test_url = inject_batch(url, &config->payloads[start], count);
+    response_t *resp = fetch_with_retries(config, client, host, test_url, NULL);
+    detect_submit(config, inbox, detect_job_new(client->curl, resp, test_url, host, url_idx, start, count));
+}
 
-            pthread_create(&threads[thread_count++], NULL, scan_worker, task);
-            start += batch;
+static bool pool_task(task_pool_t *pool, url_window_t *window, long pos, int *url_idx, int *payload_idx,
+                      int *limit) {
+    long chunk = pos / SCHEDULE_RUN;
+    long real = (chunk % window->span) * pool->workers + chunk / window->span;
+    if (real >= window->schedule_len) return false;
+    return schedule_task(pool->config, window, real * SCHEDULE_RUN + pos % SCHEDULE_RUN, url_idx, payload_idx, limit);
+}
+
+static bool claim_range(task_pool_t *pool, url_window_t *window, task_range_t *range,
+                        int *url_idx, int *payload_idx, int *count) {
+    config_t *config = pool->config;
+    bool ok = false;
+
+    pthread_mutex_lock(&range->lock);
+    while (!ok && range->next < range->end) {
+        int limit;
+        if (!pool_task(pool, window, range->next, url_idx, payload_idx, &limit)) {
+            range->next++;
+            continue;
         }
+        if (range->next + (limit - *payload_idx) > range->end) limit = *payload_idx + (int)(range->end - range->next);
+
+        *count = batch_span(config, *url_idx, *payload_idx, limit);
+        range->next += *count;
+        window_hold(window, *count);
+        ok = true;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return ok;
+}
+
+static bool steal_range(task_pool_t *pool, url_window_t *window, int self) {
+    for (;;) {
+        int victim = -1;
+        long most = 0;
+        for (int w = 0; w < pool->workers; w++) {
+            if (w == self) continue;
+            pthread_mutex_lock(&window->ranges[w].lock);
+            long left = window->ranges[w].end - window->ranges[w].next;
+            pthread_mutex_unlock(&window->ranges[w].lock);
+            if (left > most) {
+                most = left;
+                victim = w;
+            }
+        }
+        if (victim < 0) return false;
+
+        task_range_t *from = &window->ranges[victim];
+        pthread_mutex_lock(&from->lock);
+        long left = from->end - from->next;
+        long start = from->next + left / 2;
+        long end = from->end;
+        if (left > 0) from->end = start;
+        pthread_mutex_unlock(&from->lock);
+        if (left <= 0) continue;
+
+        task_range_t *to = &window->ranges[self];
+        pthread_mutex_lock(&to->lock);
+        to->next = start;
+        to->end = end;
+        pthread_mutex_unlock(&to->lock);
+        return true;
+    }
+}
+
+static bool take_task(task_pool_t *pool, url_window_t *window, int self, int *url_idx, int *payload_idx, int *count) {
+    while (!claim_range(pool, window, &window->ranges[self], url_idx, payload_idx, count)) {
+        if (!steal_range(pool, window, self)) return false;
+    }
+    return true;
+}
 
-        for (int t = 0; t < thread_count; t++) {
-            pthread_join(threads[t], NULL);
+static void drain_jobs(config_t *config, scan_result_t *result, http_client_t *client, detect_inbox_t *inbox,
+                       task_list_t *confirm) {
+    for (;;) {
+        finish_jobs(config, result, detect_take(inbox, false), confirm);
+        if (confirm->count > 0) {
+            task_ref_t *task = &confirm->tasks[--confirm->count];
+            scan_payload(config, result, client, inbox, task_host(config, task->url_idx),
+                         task->url_idx, task->payload_idx);
+            continue;
         }
+        if (detect_pending(inbox) == 0) return;
+        finish_jobs(config, result, detect_take(inbox, true), confirm);
     }
+}
 
-    free(threads);
+static void run_deferred(config_t *config, scan_result_t *result, http_client_t *client, detect_inbox_t *inbox,
+                         task_list_t *deferred, task_list_t *confirm) {
+    for (int d = 0; d < deferred->count; d++) {
+        int url_idx = deferred->tasks[d].url_idx;
+        int payload_idx = deferred->tasks[d].payload_idx;
+        host_t *host = host_lookup(config->urls[url_idx]);
 
-    time_t end_time = time(NULL);
-    int elapsed = (int)(end_time - start_time);
+        bool allowed = host_breaker_allow(host);
+        while (!allowed && host_seen_alive(host) && monotonic_ms() < deferred->tasks[d].expires) {
+            sleep_ms(BREAKER_POLL_MS);
+            allowed = host_breaker_allow(host);
+        }
+        if (!allowed) {
+            result->skipped++;
+            checkpoint_mark(config, url_idx, payload_idx);
+            window_release(config, url_idx, 1);
+            continue;
+        }
+        scan_payload(config, result, client, inbox, host, url_idx, payload_idx);
+        finish_jobs(config, result, detect_take(inbox, false), confirm);
+    }
+    result->deferred += deferred->count;
+    deferred->count = 0;
+}
 
-    printf("\n\033[90mcompleted: %d/%d in %ds\033[0m\n", result.total_found, result.total_scanned, elapsed);
+static void *scan_worker(void *arg) {
+    pool_worker_t *worker = (pool_worker_t *)arg;
+    task_pool_t *pool = worker->pool;
+    config_t *config = pool->config;
+    scan_result_t local = {0};
+    scan_result_t *result = &local;
 
-    if (config->output_file && result.vulnerable_count > 0) {
-        FILE *f = fopen(config->output_file, "w");
-        if (f) {
-            for (int i = 0; i < result.vulnerable_count; i++) {
-                fprintf(f, "%s\n", result.vulnerable_urls[i]);
+    http_client_t client;
+    if (!http_client_init(&client, config)) {
+        fprintf(stderr, "\033[91m[✗]\033[0m scan worker %d could not create a curl handle, stopping\n", worker->id);
+        feed_stop(config);
+        return NULL;
+    }
+
+    detect_inbox_t *inbox = detect_inbox_new();
+    task_list_t deferred = {0};
+    task_list_t confirm = {0};
+    int host_url = -1;
+    host_t *host = NULL;
+    int url_idx;
+    int payload_idx;
+    int count;
+
+    url_window_t *window = feed_next(config, 0, true);
+    while (window) {
+        finish_jobs(config, result, detect_take(inbox, false), &confirm);
+        if (confirm.count > 0) {
+            task_ref_t *task = &confirm.tasks[--confirm.count];
+            scan_payload(config, result, &client, inbox, task_host(config, task->url_idx),
+                         task->url_idx, task->payload_idx);
+            continue;
+        }
+        if (!take_task(pool, window, worker->id, &url_idx, &payload_idx, &count)) {
+            long seq = window->seq + 1;
+            window_leave(config, window);
+            run_deferred(config, result, &client, inbox, &deferred, &confirm);
+            host_url = -1;
+
+            window = feed_next(config, seq, false);
+            if (!window) {
+                drain_jobs(config, result, &client, inbox, &confirm);
+                window = feed_next(config, seq, true);
             }
-            fclose(f);
-            printf("\033[32m[✓]\033[0m saved to %s\n", config->output_file);
+            continue;
+        }
+
+        if (payload_idx == 0) writer_text(config, "\033[36m→\033[0m %s\n", config->urls[url_idx]);
+        if (payload_pruned(config, url_idx, payload_idx)) {
+            checkpoint_skip(config, url_idx, payload_idx, count);
+            window_release(config, url_idx, count);
+            continue;
+        }
+
+        if (url_idx != host_url) {
+            host = task_host(config, url_idx);
+            host_url = url_idx;
+        }
+
+        if (host && config->breaker > 0 && !host_breaker_allow(host)) {
+            long expires = monotonic_ms() + 2 * BREAKER_COOLDOWN_MS;
+            for (int d = 0; d < count; d++) task_list_push(&deferred, url_idx, payload_idx + d, expires);
+        } else if (count > 1) {
+            scan_batch(config, result, &client, inbox, host, url_idx, payload_idx, count);
+        } else {
+            scan_payload(config, result, &client, inbox, host, url_idx, payload_idx);
+        }
+    }
+
+    drain_jobs(config, result, &client, inbox, &confirm);
+    free(deferred.tasks);
+    free(confirm.tasks);
+    detect_inbox_free(inbox);
+    http_stats_merge(&local.http, &client.stats);
+
+    pthread_mutex_lock(&pool->result->mutex);
+    scan_result_merge(pool->result, &local);
+    pthread_mutex_unlock(&pool->result->mutex);
+
+    http_client_cleanup(&client);
+    return NULL;
+}
+
+static task_pool_t *thread_start(config_t *config, scan_result_t *result) {
+    task_pool_t *pool = calloc(1, sizeof(task_pool_t));
+    pool->config = config;
+    pool->result = result;
+    pool->workers = config->threads;
+    pool->threads = malloc(pool->workers * sizeof(pthread_t));
+    pool->args = malloc(pool->workers * sizeof(pool_worker_t));
+
+    for (int w = 0; w < pool->workers; w++) {
+        pool->args[w].pool = pool;
+        pool->args[w].id = w;
+        if (pthread_create(&pool->threads[w], NULL, scan_worker, &pool->args[w]) != 0) {
+            fprintf(stderr, "\033[91m[✗]\033[0m could not start scan worker %d, stopping\n", w);
+            feed_stop(config);
+            break;
+        }
+        pool->started++;
+    }
+    return pool;
+}
+
+static void thread_stop(task_pool_t *pool) {
+    if (!pool) return;
+
+    for (int w = 0; w < pool->started; w++) {
+        pthread_join(pool->threads[w], NULL);
+    }
+    free(pool->threads);
+    free(pool->args);
+    free(pool);
+}
+
+static void thread_ranges(config_t *config, url_window_t *window) {
+    int workers = config->threads;
+    window->span = (window->schedule_len + workers - 1) / workers;
+    window->ranges = malloc(workers * sizeof(task_range_t));
+    for (int w = 0; w < workers; w++) {
+        pthread_mutex_init(&window->ranges[w].lock, NULL);
+        window->ranges[w].next = window->span * SCHEDULE_RUN * w;
+        window->ranges[w].end = window->span * SCHEDULE_RUN * (w + 1);
+    }
+}
+
+static void print_host_window(host_t *host, void *ctx) {
+    (void)ctx;
+    if (host->requests == 0) return;
+    printf("\033[90m  %s: window %.1f, latency %.0fms (base %.0fms), %ld backoffs\033[0m\n",
+           host->key, host->window, host->avg_latency, host->base_latency, host->backoffs);
+}
+
+typedef struct {
+    char **urls;
+    int count;
+    int next;
+} url_list_t;
+
+static int read_urls(config_t *config, url_list_t *list, char **urls, int max, bool fill) {
+    if (config->url_stream) return url_stream_next(config->url_stream, urls, max, fill);
+
+    int count = list->count - list->next < max ? list->count - list->next : max;
+    memcpy(urls, &list->urls[list->next], count * sizeof(char *));
+    list->next += count;
+    return count;
+}
+
+static void retire_window(config_t *config, scan_result_t *result, url_window_t *window) {
+    if (config->journal) writer_sync(config);
+    if (!feed_stopped(config)) checkpoint_window_done(config, window);
+    for (int u = window->base; u < window->base + window->count; u++) {
+        free(config->urls[u]);
+        config->urls[u] = NULL;
+    }
+    free(window->schedule);
+    free(window->hosts);
+    if (window->ranges) {
+        for (int w = 0; w < config->threads; w++) pthread_mutex_destroy(&window->ranges[w].lock);
+        free(window->ranges);
+    }
+    result->hosts_evicted += hosts_trim(window->seq);
+}
+
+static bool load_window(config_t *config, scan_result_t *result, url_list_t *list) {
+    url_window_t *window;
+    while (!(window = feed_open(config))) {
+        url_window_t *done = feed_retire(config);
+        if (!done) return false;
+        retire_window(config, result, done);
+    }
+
+    window->read = read_urls(config, list, &config->urls[window->base], config->url_window, config->journal != NULL);
+    if (window->read == 0) return false;
+    window->count = window->read;
+    result->urls_read += window->read;
+    result->windows++;
+
+    if (config->url_origin) {
+        for (int u = window->base; u < window->base + window->count; u++) config->url_origin[u] = u;
+    }
+    if (config->preflight || config->probe) run_preflight(config, result, window);
+    class_state_reset(config, window);
+    found_set_points(config, window);
+    shard_hash_urls(config, window);
+    schedule_init(config, window);
+    hosts_advance(window->seq);
+
+    if (config->concurrency == 0) {
+        thread_ranges(config, window);
+    } else if (config->adaptive || config->breaker > 0 || config->host_cap > 0 || config->timings || config->dedup) {
+        window->hosts = malloc(window->count * sizeof(host_t *));
+        for (int u = 0; u < window->count; u++) {
+            window->hosts[u] = host_lookup(config->urls[window->base + u]);
         }
     }
+    feed_publish(config, window);
+    return true;
+}
+
+void run_scan(config_t *config) {
+    long start_ms = monotonic_ms();
+
+    scan_result_t result = {
+        .total_scanned = 0,
+        .total_found = 0,
+        .failed = 0,
+        .skipped = 0,
+        .deferred = 0,
+        .urls_read = 0,
+        .windows = 0,
+        .hosts_evicted = 0,
+        .batch_requests = 0,
+        .batch_payloads = 0,
+        .batch_candidates = 0,
+        .preflight_requests = 0,
+        .preflight_dropped = 0,
+        .probe_pruned_urls = 0,
+        .pruned = 0,
+        .class_skipped = 0,
+        .first_hit_skipped = 0,
+        .dedup_hits = 0,
+        .dedup_misses = 0,
+        .http = {0},
+    };
+    pthread_mutex_init(&result.mutex, NULL);
 
-    for (int i = 0; i < result.vulnerable_count; i++) {
-        free(result.vulnerable_urls[i]);
+    checkpoint_restore(config, &result);
+    detect_start(config);
+
+    url_list_t list = {config->urls, config->url_count, 0};
+    feed_init(config, checkpoint_windows(config));
+    if (config->journal) config->url_origin = malloc(config->url_slots * sizeof(int));
+    class_state_init(config);
+    found_set_init(config);
+    shard_init(config);
+
+    for (long consumed = checkpoint_consumed(config); consumed > 0;) {
+        int count = read_urls(config, &list, config->urls,
+                              consumed < config->url_slots ? (int)consumed : config->url_slots, true);
+        if (count == 0) break;
+        for (int u = 0; u < count; u++) free(config->urls[u]);
+        consumed -= count;
+    }
+
+    task_pool_t *pool = NULL;
+    multi_engine_t *multi = NULL;
+    if (load_window(config, &result, &list)) {
+        if (config->concurrency > 0) {
+            multi = multi_start(config, &result);
+        } else {
+            pool = thread_start(config, &result);
+        }
+        while (load_window(config, &result, &list)) {}
+    }
+    feed_close(config);
+
+    url_window_t *window;
+    while ((window = feed_retire(config))) retire_window(config, &result, window);
+    thread_stop(pool);
+    multi_stop(multi);
+
+    free(config->url_origin);
+    config->url_origin = NULL;
+    feed_free(config);
+    config->urls = list.urls;
+    config->url_count = 0;
+
+    detect_stop(config, &result);
+    writer_stop(config);
+    long elapsed_ms = monotonic_ms() - start_ms;
+
+    printf("\n\033[90mcompleted: %d/%d in %.2fs\033[0m\n", result.total_found, result.total_scanned,
+           elapsed_ms / 1000.0);
+    if (result.failed + result.skipped + result.deferred > 0 || result.http.retries > 0) {
+        printf("\033[90mfailures: %d failed, %ld retried, %d deferred, %d skipped (circuit open)\033[0m\n",
+               result.failed, result.http.retries, result.deferred, result.skipped);
+    }
+    if (config->url_stream) {
+        printf("\033[90minput: %ld URLs streamed in %d windows of up to %d", result.urls_read, result.windows,
+               config->url_window);
+        if (result.hosts_evicted > 0) printf(", %ld idle hosts evicted", result.hosts_evicted);
+        printf("\033[0m\n");
     }
-    free(result.vulnerable_urls);
+    if (config->shard_count > 1) {
+        printf("\033[90mshard: %d/%d, this process owns ~1/%d of every URL's payloads, "
+               "preflight repeated on every shard (%d requests here)\033[0m\n",
+               config->shard_index + 1, config->shard_count, config->shard_count,
+               result.preflight_requests + result.probe_requests);
+    }
+    if (config->host_groups > 1 || config->host_cap > 0) {
+        printf("\033[90mscheduler: %d hosts interleaved in runs of %d payloads", config->host_groups, SCHEDULE_RUN);
+        if (config->host_cap > 0) printf(", at most %d in flight per host", config->host_cap);
+        printf("\033[0m\n");
+    }
+    if (result.preflight_requests > 0) {
+        int per_url = (config->payload_count + config->batch - 1) / config->batch;
+        printf("\033[90mpreflight: %d/%d URLs dropped (no reflection), ~%ld requests avoided for %d canaries\033[0m\n",
+               result.preflight_dropped, result.preflight_requests,
+               (long)result.preflight_dropped * per_url, result.preflight_requests);
+    }
+    if (result.pruned > 0) {
+        printf("\033[90mprobe: %ld payloads pruned on %d URLs (special characters encoded)\033[0m\n",
+               result.pruned, result.probe_pruned_urls);
+    }
+    if (config->history) {
+        long tries, hits;
+        history_run_totals(config, &tries, &hits);
+        printf("\033[90mhistory: %d payloads reordered from %ld past requests (%ld hits), %ld hits in %ld requests this run\033[0m\n",
+               config->history->moved, config->history->past_tries, config->history->past_hits, hits, tries);
+    }
+    if (config->classes) {
+        printf("\033[90mclasses: %d payload classes, %ld payloads skipped after a class was confirmed or blocked\033[0m\n",
+               config->class_count, result.class_skipped);
+    }
+    if (config->first_hit) {
+        printf("\033[90mfirst hit: %ld payloads cancelled on already proven injection points\033[0m\n",
+               result.first_hit_skipped);
+    }
+    if (result.dedup_hits + result.dedup_misses > 0) {
+        printf("\033[90mdedup: %ld/%ld reflected responses repeated a clean page (%.1f%% hit rate)\033[0m\n",
+               result.dedup_hits, result.dedup_hits + result.dedup_misses,
+               100.0 * result.dedup_hits / (result.dedup_hits + result.dedup_misses));
+    }
+    if (result.detect_jobs > 0) {
+        printf("\033[90mdetection: %d workers, queue depth avg %.1f max %d of %d, %ld network stalls on a full queue\033[0m\n",
+               result.detect_workers, (double)result.detect_depth_sum / result.detect_jobs,
+               result.detect_depth_max, DETECT_QUEUE_DEPTH, result.detect_stalls);
+    }
+    if (result.batch_requests > 0) {
+        printf("\033[90mbatching: %d payloads in %d requests, %d candidates re-tested alone\033[0m\n",
+               result.batch_payloads, result.batch_requests, result.batch_candidates);
+    }
+    if (result.http.requests > 0) {
+        printf("\033[90mconnections: %ld opened, %ld/%ld requests reused (%.1f%%)\033[0m\n",
+               result.http.connects, result.http.reused, result.http.requests,
+               100.0 * result.http.reused / result.http.requests);
+    }
+    if (result.http.dns_hits + result.http.dns_misses > 0) {
+        printf("\033[90mshared cache: dns %ld hits / %ld misses",
+               result.http.dns_hits, result.http.dns_misses);
+        if (result.http.tls_resumed + result.http.tls_full > 0) {
+            printf(", tls %ld resumed / %ld full handshakes", result.http.tls_resumed, result.http.tls_full);
+        }
+        printf("\033[0m\n");
+    }
+    if (result.http.requests > 0) {
+        printf("\033[90mbuffers: %ld allocations for %ld requests (%.2f per request)\033[0m\n",
+               result.http.buffer_allocs, result.http.requests,
+               (double)result.http.buffer_allocs / result.http.requests);
+    }
+    if (result.http.wire_bytes > 0) {
+        printf("\033[90mtransfer: %.1f KB on the wire, %.1f KB decoded (%.1fx)",
+               result.http.wire_bytes / 1024.0, result.http.decoded_bytes / 1024.0,
+               (double)result.http.decoded_bytes / result.http.wire_bytes);
+        if (result.http.truncated > 0) {
+            printf(", %ld bodies cut at %d KB", result.http.truncated, MAX_RESPONSE_SIZE / 1024);
+        }
+        printf("\033[0m\n");
+    }
+    if (result.http.stream_hits + result.http.stream_misses > 0) {
+        printf("\033[90mstreaming: %ld confirmed early, %ld abandoned unreflected, %.1f KB not downloaded\033[0m\n",
+               result.http.stream_hits, result.http.stream_misses, result.http.bytes_saved / 1024.0);
+    }
+    if (config->http2) {
+        printf("\033[90mhttp/2: %ld/%ld responses multiplexed\033[0m\n",
+               result.http.h2_responses, result.http.requests);
+    }
+    if (config->adaptive) {
+        printf("\033[90madaptive concurrency:\033[0m\n");
+        hosts_foreach(print_host_window, NULL);
+    }
+    if (config->timings) timing_print(&result.http);
+    if (config->timings_file) {
+        if (timing_write(config->timings_file, &result.http, elapsed_ms)) {
+            printf("\033[32m[✓]\033[0m timings saved to %s\n", config->timings_file);
+        } else {
+            fprintf(stderr, "\033[33m[!]\033[0m failed to write timings to %s\n", config->timings_file);
+        }
+    }
+
+    if (config->output_file) printf("\033[32m[✓]\033[0m saved to %s\n", config->output_file);
     pthread_mutex_destroy(&result.mutex);
 }
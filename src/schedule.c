@@ -0,0 +1,93 @@
+#include "xssmap.h"
+
+typedef struct {
+    uint64_t key;
+    int *urls;
+    int url_count;
+    int cursor;
+} host_group_t;
+
+static int find_group(host_group_t *groups, int *group_count, int *slots, size_t slot_count, uint64_t key) {
+    size_t slot = key & (slot_count - 1);
+    while (slots[slot] >= 0 && groups[slots[slot]].key != key) slot = (slot + 1) & (slot_count - 1);
+
+    if (slots[slot] < 0) {
+        slots[slot] = (*group_count)++;
+        groups[slots[slot]].key = key;
+    }
+    return slots[slot];
+}
+
+void schedule_init(config_t *config, url_window_t *window) {
+    window->schedule = NULL;
+    window->schedule_len = 0;
+    if (window->count == 0) return;
+
+    int chunks = (config->payload_count + SCHEDULE_RUN - 1) / SCHEDULE_RUN;
+    size_t slot_count = 16;
+    while (slot_count < (size_t)window->count * 2) slot_count *= 2;
+
+    host_group_t *groups = calloc(window->count, sizeof(host_group_t));
+    int *slots = malloc(slot_count * sizeof(int));
+    int *url_group = malloc(window->count * sizeof(int));
+    int group_count = 0;
+    for (size_t i = 0; i < slot_count; i++) slots[i] = -1;
+
+    for (int u = 0; u < window->count; u++) {
+        char key[MAX_URL_LEN];
+        const char *url = config->urls[window->base + u];
+        const char *name = url_host_key(url, key, sizeof(key)) ? key : url;
+        url_group[u] = find_group(groups, &group_count, slots, slot_count, hash64(name, strlen(name)));
+        groups[url_group[u]].url_count++;
+    }
+    for (int g = 0; g < group_count; g++) {
+        groups[g].urls = malloc(groups[g].url_count * sizeof(int));
+        groups[g].url_count = 0;
+    }
+    for (int u = 0; u < window->count; u++) {
+        host_group_t *group = &groups[url_group[u]];
+        group->urls[group->url_count++] = window->base + u;
+    }
+
+    window->schedule = malloc((size_t)window->count * chunks * sizeof(schedule_entry_t));
+    long len = 0;
+    for (int chunk = 0; chunk < chunks; chunk++) {
+        for (int g = 0; g < group_count; g++) groups[g].cursor = 0;
+
+        for (bool emitted = true; emitted;) {
+            emitted = false;
+            for (int g = 0; g < group_count; g++) {
+                host_group_t *group = &groups[g];
+                if (group->cursor >= group->url_count) continue;
+
+                window->schedule[len].url_idx = group->urls[group->cursor++];
+                window->schedule[len].chunk = chunk;
+                len++;
+                emitted = true;
+            }
+        }
+    }
+    window->schedule_len = len;
+    if (group_count > config->host_groups) config->host_groups = group_count;
+
+    for (int g = 0; g < group_count; g++) free(groups[g].urls);
+    free(groups);
+    free(slots);
+    free(url_group);
+}
+
+long schedule_total(const url_window_t *window) {
+    return window->schedule_len * SCHEDULE_RUN;
+}
+
+bool schedule_task(const config_t *config, const url_window_t *window, long pos, int *url_idx, int *payload_idx,
+                   int *limit) {
+    const schedule_entry_t *entry = &window->schedule[pos / SCHEDULE_RUN];
+    int start = entry->chunk * SCHEDULE_RUN;
+    int end = start + SCHEDULE_RUN < config->payload_count ? start + SCHEDULE_RUN : config->payload_count;
+
+    *url_idx = entry->url_idx;
+    *payload_idx = start + (int)(pos % SCHEDULE_RUN);
+    *limit = end;
+    return *payload_idx < end;
+}
@@ -0,0 +1,121 @@
+#include "xssmap.h"
+#include <getopt.h>
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+bool shard_parse(const char *spec, int *index, int *count) {
+    char *end;
+    long i = strtol(spec, &end, 10);
+    if (*end != '/') return false;
+    long n = strtol(end + 1, &end, 10);
+    if (*end != '\0' || n < 1 || i < 1 || i > n) return false;
+
+    *index = (int)i - 1;
+    *count = (int)n;
+    return true;
+}
+
+void shard_init(config_t *config) {
+    free(config->url_hash);
+    config->url_hash = NULL;
+    if (config->shard_count <= 1) return;
+
+    if (!config->payload_hash) {
+        config->payload_hash = malloc(config->payload_count * sizeof(uint64_t));
+        for (int p = 0; p < config->payload_count; p++) {
+            config->payload_hash[p] = hash64(config->payloads[p], strlen(config->payloads[p]));
+        }
+    }
+    config->url_hash = malloc(config->url_slots * sizeof(uint64_t));
+}
+
+void shard_hash_urls(config_t *config, const url_window_t *window) {
+    if (!config->url_hash) return;
+
+    for (int u = window->base; u < window->base + window->count; u++) {
+        config->url_hash[u] = hash64(config->urls[u], strlen(config->urls[u]));
+    }
+}
+
+bool shard_owns(const config_t *config, int url_idx, int payload_idx) {
+    if (!config->url_hash) return true;
+
+    uint64_t key = mix64(config->url_hash[url_idx] ^ mix64(config->payload_hash[payload_idx]));
+    return key % (uint64_t)config->shard_count == (uint64_t)config->shard_index;
+}
+
+static bool line_seen(char **lines, int *slots, size_t mask, int idx) {
+    size_t slot = hash64(lines[idx], strlen(lines[idx])) & mask;
+    while (slots[slot] >= 0) {
+        if (strcmp(lines[slots[slot]], lines[idx]) == 0) return true;
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = idx;
+    return false;
+}
+
+int run_merge(int argc, char *argv[]) {
+    const char *output = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "o:")) != -1) {
+        if (opt != 'o') {
+            fprintf(stderr, "usage: xssmap merge [-o output] results...\n");
+            return 1;
+        }
+        output = optarg;
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: xssmap merge [-o output] results...\n");
+        return 1;
+    }
+
+    char **lines = NULL;
+    int line_count = 0;
+    for (int i = optind; i < argc; i++) {
+        int count = 0;
+        char **file_lines = load_file_lines(argv[i], &count);
+        if (!file_lines) {
+            fprintf(stderr, "\033[91m[✗]\033[0m failed to read %s\n", argv[i]);
+            free_lines(lines, line_count);
+            return 1;
+        }
+        lines = realloc(lines, (line_count + count) * sizeof(char *));
+        memcpy(&lines[line_count], file_lines, count * sizeof(char *));
+        line_count += count;
+        free(file_lines);
+    }
+
+    size_t slot_count = 16;
+    while (slot_count < (size_t)line_count * 2) slot_count *= 2;
+    int *slots = malloc(slot_count * sizeof(int));
+    for (size_t i = 0; i < slot_count; i++) slots[i] = -1;
+
+    FILE *f = output ? fopen(output, "w") : stdout;
+    if (!f) {
+        fprintf(stderr, "\033[91m[✗]\033[0m failed to open %s\n", output);
+        free(slots);
+        free_lines(lines, line_count);
+        return 1;
+    }
+
+    int unique = 0;
+    for (int i = 0; i < line_count; i++) {
+        if (line_seen(lines, slots, slot_count - 1, i)) continue;
+        fprintf(f, "%s\n", lines[i]);
+        unique++;
+    }
+    if (output) fclose(f);
+
+    fprintf(stderr, "\033[32m[✓]\033[0m merged %d findings from %d files (%d duplicates)\n",
+            unique, argc - optind, line_count - unique);
+
+    free(slots);
+    free_lines(lines, line_count);
+    return 0;
+}
@@ -20,6 +20,15 @@ static bool ci_strstr(const char *haystack, const char *needle) {
     return false;
 }
 
+static bool has_marker(const char *payload, const char **markers) {
+    for (int i = 0; markers[i]; i++) {
+        if (ci_strstr(payload, markers[i])) return true;
+    }
+    return false;
+}
+
+const char *template_markers[] = {"${", "{{", "<%", NULL};
+
 bool technique_template_injection(const char *response, const char *payload, detection_result_t *result) {
     result->vulnerable = false;
     result->confidence = 0;
@@ -28,10 +37,7 @@ bool technique_template_injection(const char *response, const char *payload, det
     
     if (!response || !payload || strlen(payload) == 0) return false;
     
-    bool has_template = (strstr(payload, "${") != NULL) || 
-                        (strstr(payload, "{{") != NULL) ||
-                        (strstr(payload, "<%") != NULL);
-    if (!has_template) return false;
+    if (!has_marker(payload, template_markers)) return false;
     
     if (!ci_strstr(response, payload)) return false;
     
@@ -111,6 +117,15 @@ bool technique_template_injection(const char *response, const char *payload, det
     return false;
 }
 
+const char *csp_patterns[] = {
+    "<base href=",
+    "<link rel=\"import\"",
+    "<meta http-equiv=\"refresh\"",
+    "require(",
+    "import(",
+    NULL
+};
+
 bool technique_csp_bypass(const char *response, const char *payload, detection_result_t *result) {
     result->vulnerable = false;
     result->confidence = 0;
@@ -119,18 +134,9 @@ bool technique_csp_bypass(const char *response, const char *payload, detection_r
     
     if (!response || !payload || strlen(payload) == 0) return false;
     
-    const char *bypass_patterns[] = {
-        "<base href=",
-        "<link rel=\"import\"",
-        "<meta http-equiv=\"refresh\"",
-        "require(",
-        "import(",
-        NULL
-    };
-    
     bool has_bypass = false;
-    for (int i = 0; bypass_patterns[i]; i++) {
-        if (ci_strstr(payload, bypass_patterns[i])) {
+    for (int i = 0; csp_patterns[i]; i++) {
+        if (ci_strstr(payload, csp_patterns[i])) {
             has_bypass = true;
             break;
         }
@@ -171,6 +177,8 @@ bool technique_csp_bypass(const char *response, const char *payload, detection_r
     return false;
 }
 
+const char *clobber_markers[] = {"id=", "name=", NULL};
+
 bool technique_dom_clobbering(const char *response, const char *payload, detection_result_t *result) {
     result->vulnerable = false;
     result->confidence = 0;
@@ -179,8 +187,7 @@ bool technique_dom_clobbering(const char *response, const char *payload, detecti
     
     if (!response || !payload || strlen(payload) == 0) return false;
     
-    bool has_clobber = ci_strstr(payload, "id=") || ci_strstr(payload, "name=");
-    if (!has_clobber) return false;
+    if (!has_marker(payload, clobber_markers)) return false;
     
     const char *clobber_targets[] = {
         "id=\"location\"", "id='location'",
@@ -204,7 +211,7 @@ bool technique_dom_clobbering(const char *response, const char *payload, detecti
     }
     
     if (ci_strstr(response, "<form") && ci_strstr(payload, "<form") &&
-        (ci_strstr(payload, "id=") || ci_strstr(payload, "name="))) {
+        has_marker(payload, clobber_markers)) {
         result->vulnerable = true;
         result->confidence = 82;
         result->context = CTX_HTML_TEXT;
@@ -215,6 +222,16 @@ bool technique_dom_clobbering(const char *response, const char *payload, detecti
     return false;
 }
 
+const char *mutation_patterns[] = {
+    "<noscript><p title=\"</noscript><script>",
+    "<table><colgroup><col style=\"</colgroup>",
+    "<style><a style=\"</style><script>",
+    "<title><style></title><script>",
+    "<textarea></textarea><script>",
+    "</select><script>",
+    NULL
+};
+
 bool technique_mutation_xss(const char *response, const char *payload, detection_result_t *result) {
     result->vulnerable = false;
     result->confidence = 0;
@@ -223,16 +240,6 @@ bool technique_mutation_xss(const char *response, const char *payload, detection
     
     if (!response || !payload || strlen(payload) == 0) return false;
     
-    const char *mutation_patterns[] = {
-        "<noscript><p title=\"</noscript><script>",
-        "<table><colgroup><col style=\"</colgroup>",
-        "<style><a style=\"</style><script>",
-        "<title><style></title><script>",
-        "<textarea></textarea><script>",
-        "</select><script>",
-        NULL
-    };
-    
     for (int i = 0; mutation_patterns[i]; i++) {
         if (ci_strstr(payload, mutation_patterns[i]) && ci_strstr(response, payload)) {
             result->vulnerable = true;
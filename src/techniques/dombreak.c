@@ -20,6 +20,19 @@ static bool ci_strstr(const char *haystack, const char *needle) {
     return false;
 }
 
+const char *breakout_sequences[] = {
+    "</script>", "</SCRIPT>", "</ScRiPt>",
+    "</style>", "</STYLE>",
+    "</title>", "</TITLE>",
+    "</textarea>", "</TEXTAREA>",
+    "</noscript>", "</NOSCRIPT>",
+    "</xmp>", "</plaintext>", "</listing>",
+    "</noframes>", "</comment>",
+    "-->", "--!>",
+    "]]>",
+    NULL
+};
+
 bool technique_dom_breakout(const char *response, const char *payload, detection_result_t *result) {
     if (!response || !payload || strlen(payload) == 0) {
         result->vulnerable = false;
@@ -31,19 +44,6 @@ bool technique_dom_breakout(const char *response, const char *payload, detection
     result->reason = NULL;
     result->context = CTX_UNKNOWN;
     
-    const char *breakout_sequences[] = {
-        "</script>", "</SCRIPT>", "</ScRiPt>",
-        "</style>", "</STYLE>",
-        "</title>", "</TITLE>",
-        "</textarea>", "</TEXTAREA>",
-        "</noscript>", "</NOSCRIPT>",
-        "</xmp>", "</plaintext>", "</listing>",
-        "</noframes>", "</comment>",
-        "-->", "--!>",
-        "]]>",
-        NULL
-    };
-    
     for (int i = 0; breakout_sequences[i]; i++) {
         if (ci_strstr(payload, breakout_sequences[i])) {
             if (ci_strstr(response, payload)) {
@@ -20,7 +20,7 @@ static bool ci_strstr(const char *haystack, const char *needle) {
     return false;
 }
 
-static const char *popup_functions[] = {
+const char *popup_functions[] = {
     "alert(", "confirm(", "prompt(", "console.log(", "console.error(",
     "console.warn(", "console.info(", "eval(", "Function(", "setTimeout(",
     "setInterval(", "document.write(", "document.writeln(",
@@ -37,6 +37,12 @@ static const char *ci_find(const char *haystack, const char *needle) {
     return NULL;
 }
 
+const char *script_starters[] = {
+    "<script>", "<script ", "<script/", "<script\t", "<script\n",
+    "<SCRIPT>", "<SCRIPT ", "<ScRiPt>", "<ScRiPt ",
+    NULL
+};
+
 bool technique_script_injection(const char *response, const char *payload, detection_result_t *result) {
     if (!response || !payload || strlen(payload) == 0) {
         result->vulnerable = false;
@@ -48,12 +54,6 @@ bool technique_script_injection(const char *response, const char *payload, detec
     result->reason = NULL;
     result->context = CTX_UNKNOWN;
     
-    const char *script_starters[] = {
-        "<script>", "<script ", "<script/", "<script\t", "<script\n",
-        "<SCRIPT>", "<SCRIPT ", "<ScRiPt>", "<ScRiPt ",
-        NULL
-    };
-    
     for (int i = 0; script_starters[i]; i++) {
         if (ci_strstr(payload, script_starters[i])) {
             const char *pos = ci_find(response, script_starters[i]);
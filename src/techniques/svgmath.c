@@ -20,16 +20,16 @@ static bool ci_strstr(const char *haystack, const char *needle) {
     return false;
 }
 
-static const char *svg_tags[] = {
+const char *svg_tags[] = {
     "<svg", "<animate", "<set", "<animatetransform", "<animatemotion",
     "<use", "<foreignobject", "<image", NULL
 };
 
-static const char *math_tags[] = {
+const char *math_tags[] = {
     "<math", "<maction", "<annotation-xml", NULL
 };
 
-static const char *iframe_tags[] = {
+const char *iframe_tags[] = {
     "<iframe", "<frame", "<embed", "<object", "<applet", NULL
 };
 
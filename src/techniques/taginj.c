@@ -20,6 +20,12 @@ static bool ci_strstr(const char *haystack, const char *needle) {
     return false;
 }
 
+const char *injection_tags[] = {
+    "<script", "<svg", "<img", "<iframe", "<object", "<embed",
+    "<video", "<audio", "<body", "<math", "<details",
+    NULL
+};
+
 bool technique_tag_injection(const char *response, const char *payload, detection_result_t *result) {
     if (!response || !payload || strlen(payload) == 0) {
         result->vulnerable = false;
@@ -69,14 +75,8 @@ bool technique_tag_injection(const char *response, const char *payload, detectio
         }
     }
     
-    const char *dangerous_tags[] = {
-        "<script", "<svg", "<img", "<iframe", "<object", "<embed",
-        "<video", "<audio", "<body", "<math", "<details",
-        NULL
-    };
-    
-    for (int i = 0; dangerous_tags[i]; i++) {
-        if (ci_strstr(payload, dangerous_tags[i])) {
+    for (int i = 0; injection_tags[i]; i++) {
+        if (ci_strstr(payload, injection_tags[i])) {
             result->vulnerable = true;
             result->confidence = 96;
             result->reason = "dangerous tag injection";
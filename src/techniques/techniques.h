@@ -59,4 +59,17 @@ bool technique_mutation_xss(const char *response, const char *payload, detection
 
 bool run_all_techniques(const char *response, const char *payload, detection_result_t *result);
 
+extern const char *popup_functions[];
+extern const char *script_starters[];
+extern const char *uri_protocols[];
+extern const char *svg_tags[];
+extern const char *math_tags[];
+extern const char *iframe_tags[];
+extern const char *template_markers[];
+extern const char *mutation_patterns[];
+extern const char *csp_patterns[];
+extern const char *clobber_markers[];
+extern const char *injection_tags[];
+extern const char *breakout_sequences[];
+
 #endif
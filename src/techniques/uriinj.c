@@ -71,6 +71,12 @@ static bool is_html_encoded(const char *response, const char *payload) {
     return false;
 }
 
+const char *uri_protocols[] = {
+    "javascript:", "vbscript:", "data:text/html",
+    "data:application/xhtml", "data:image/svg+xml",
+    NULL
+};
+
 bool technique_uri_injection(const char *response, const char *payload, detection_result_t *result) {
     if (!response || !payload || strlen(payload) == 0) {
         result->vulnerable = false;
@@ -82,15 +88,9 @@ bool technique_uri_injection(const char *response, const char *payload, detectio
     result->reason = NULL;
     result->context = CTX_UNKNOWN;
     
-    const char *dangerous_protos[] = {
-        "javascript:", "vbscript:", "data:text/html",
-        "data:application/xhtml", "data:image/svg+xml",
-        NULL
-    };
-    
     bool has_dangerous = false;
-    for (int i = 0; dangerous_protos[i]; i++) {
-        if (ci_strstr(payload, dangerous_protos[i])) {
+    for (int i = 0; uri_protocols[i]; i++) {
+        if (ci_strstr(payload, uri_protocols[i])) {
             has_dangerous = true;
             break;
         }
@@ -0,0 +1,194 @@
+#include "xssmap.h"
+
+static const char *phase_names[PHASE_COUNT] = {"dns", "connect", "tls", "ttfb", "transfer", "detect", "total"};
+
+static int bucket_of(long us) {
+    unsigned long v = us > 0 ? (unsigned long)us : 0;
+    if (v < (1UL << TIMING_SUB_BITS)) return (int)v;
+
+    int shift = 63 - __builtin_clzl(v) - TIMING_SUB_BITS;
+    int idx = ((shift + 1) << TIMING_SUB_BITS) + (int)((v >> shift) - (1UL << TIMING_SUB_BITS));
+    return idx < TIMING_BUCKETS ? idx : TIMING_BUCKETS - 1;
+}
+
+static long bucket_value(int idx) {
+    if (idx < (1 << TIMING_SUB_BITS)) return idx;
+
+    int shift = (idx >> TIMING_SUB_BITS) - 1;
+    long base = (long)((idx & ((1 << TIMING_SUB_BITS) - 1)) + (1 << TIMING_SUB_BITS)) << shift;
+    return base + ((1L << shift) >> 1);
+}
+
+void timing_record(latency_hist_t *hist, long us) {
+    hist->buckets[bucket_of(us)]++;
+    hist->count++;
+    hist->sum += us;
+}
+
+void timing_merge(latency_hist_t *dst, const latency_hist_t *src) {
+    if (src->count == 0) return;
+    for (int b = 0; b < TIMING_BUCKETS; b++) dst->buckets[b] += src->buckets[b];
+    dst->count += src->count;
+    dst->sum += src->sum;
+}
+
+long timing_percentile(const latency_hist_t *hist, double q) {
+    if (hist->count == 0) return 0;
+
+    long rank = (long)(q * hist->count + 0.999999);
+    if (rank < 1) rank = 1;
+    long seen = 0;
+    for (int b = 0; b < TIMING_BUCKETS; b++) {
+        seen += hist->buckets[b];
+        if (seen >= rank) return bucket_value(b);
+    }
+    return bucket_value(TIMING_BUCKETS - 1);
+}
+
+static void transfer_phases(CURL *curl, long *us) {
+    curl_off_t namelookup = 0, connect = 0, appconnect = 0, pretransfer = 0, starttransfer = 0, total = 0;
+    long connects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &namelookup);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appconnect);
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &starttransfer);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+
+    for (int p = 0; p < PHASE_COUNT; p++) us[p] = -1;
+    if (connects > 0) {
+        us[PHASE_DNS] = namelookup;
+        if (connect >= namelookup) us[PHASE_CONNECT] = connect - namelookup;
+        if (appconnect > 0 && appconnect >= connect) us[PHASE_TLS] = appconnect - connect;
+    }
+    if (starttransfer > 0) {
+        us[PHASE_TTFB] = starttransfer - pretransfer;
+        us[PHASE_TRANSFER] = total - starttransfer;
+    }
+    us[PHASE_TOTAL] = total;
+}
+
+void timing_record_transfer(http_stats_t *stats, CURL *curl) {
+    long us[PHASE_COUNT];
+    transfer_phases(curl, us);
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        if (us[p] >= 0) timing_record(&stats->timing[p], us[p]);
+    }
+}
+
+static atomic_long *host_buckets(host_t *host) {
+    atomic_long *buckets = atomic_load_explicit(&host->timing, memory_order_acquire);
+    if (buckets) return buckets;
+
+    atomic_long *fresh = calloc((size_t)PHASE_COUNT * TIMING_BUCKETS, sizeof(atomic_long));
+    atomic_long *expected = NULL;
+    if (atomic_compare_exchange_strong(&host->timing, &expected, fresh)) return fresh;
+    free(fresh);
+    return expected;
+}
+
+void timing_record_host(host_t *host, CURL *curl) {
+    atomic_long *buckets = host_buckets(host);
+
+    long us[PHASE_COUNT];
+    transfer_phases(curl, us);
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        if (us[p] < 0) continue;
+        atomic_fetch_add_explicit(&buckets[(size_t)p * TIMING_BUCKETS + bucket_of(us[p])], 1, memory_order_relaxed);
+    }
+}
+
+void timing_record_host_phase(host_t *host, timing_phase_t phase, long us) {
+    atomic_long *buckets = host_buckets(host);
+    atomic_fetch_add_explicit(&buckets[(size_t)phase * TIMING_BUCKETS + bucket_of(us)], 1, memory_order_relaxed);
+}
+
+static bool host_hist(host_t *host, int phase, latency_hist_t *hist) {
+    atomic_long *buckets = atomic_load_explicit(&host->timing, memory_order_acquire);
+    memset(hist, 0, sizeof(*hist));
+    if (!buckets) return false;
+
+    for (int b = 0; b < TIMING_BUCKETS; b++) {
+        long n = atomic_load_explicit(&buckets[(size_t)phase * TIMING_BUCKETS + b], memory_order_relaxed);
+        hist->buckets[b] = n;
+        hist->count += n;
+        hist->sum += n * bucket_value(b);
+    }
+    return hist->count > 0;
+}
+
+static void print_row(const char *indent, const char *name, const latency_hist_t *hist) {
+    printf("\033[90m%s%-9s %8ld  p50 %8.2fms  p90 %8.2fms  p99 %8.2fms\033[0m\n",
+           indent, name, hist->count, timing_percentile(hist, 0.50) / 1000.0,
+           timing_percentile(hist, 0.90) / 1000.0, timing_percentile(hist, 0.99) / 1000.0);
+}
+
+static void print_host_timing(host_t *host, void *ctx) {
+    (void)ctx;
+    latency_hist_t hist;
+    if (!host_hist(host, PHASE_TOTAL, &hist)) return;
+
+    printf("\033[90m  %s\033[0m\n", host->key);
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        if (host_hist(host, p, &hist)) print_row("    ", phase_names[p], &hist);
+    }
+}
+
+void timing_print(const http_stats_t *stats) {
+    printf("\033[90mtimings:\033[0m\n");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        if (stats->timing[p].count > 0) print_row("  ", phase_names[p], &stats->timing[p]);
+    }
+    printf("\033[90mtimings by host:\033[0m\n");
+    hosts_foreach(print_host_timing, NULL);
+}
+
+static void write_phase(FILE *f, const char *name, const latency_hist_t *hist, bool first) {
+    fprintf(f, "%s\"%s\":{\"count\":%ld,\"mean_us\":%ld,\"p50_us\":%ld,\"p90_us\":%ld,\"p99_us\":%ld}",
+            first ? "" : ",", name, hist->count, hist->sum / hist->count, timing_percentile(hist, 0.50),
+            timing_percentile(hist, 0.90), timing_percentile(hist, 0.99));
+}
+
+static void write_phases(FILE *f, const latency_hist_t *hists) {
+    bool first = true;
+    fputc('{', f);
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        if (hists[p].count == 0) continue;
+        write_phase(f, phase_names[p], &hists[p], first);
+        first = false;
+    }
+    fputc('}', f);
+}
+
+typedef struct {
+    FILE *f;
+    bool first;
+} host_writer_t;
+
+static void write_host_timing(host_t *host, void *ctx) {
+    host_writer_t *writer = ctx;
+    latency_hist_t hists[PHASE_COUNT];
+    bool any = false;
+    for (int p = 0; p < PHASE_COUNT; p++) any |= host_hist(host, p, &hists[p]);
+    if (!any) return;
+
+    fputs(writer->first ? "" : ",", writer->f);
+    json_write_string(writer->f, host->key);
+    fputc(':', writer->f);
+    write_phases(writer->f, hists);
+    writer->first = false;
+}
+
+bool timing_write(const char *path, const http_stats_t *stats, long elapsed_ms) {
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+
+    fprintf(f, "{\"elapsed_ms\":%ld,\"requests\":%ld,\"phases\":", elapsed_ms, stats->requests);
+    write_phases(f, stats->timing);
+    fputs(",\"hosts\":{", f);
+    host_writer_t writer = {f, true};
+    hosts_foreach(write_host_timing, &writer);
+    fputs("}}\n", f);
+    return fclose(f) == 0;
+}
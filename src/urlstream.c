@@ -0,0 +1,108 @@
+#include "xssmap.h"
+
+struct url_stream {
+    FILE *f;
+    pthread_t reader;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    char **ring;
+    int head;
+    int count;
+    bool eof;
+    bool closed;
+};
+
+static void *reader_main(void *arg) {
+    url_stream_t *stream = (url_stream_t *)arg;
+    char buf[MAX_PAYLOAD_LEN];
+
+    while (fgets(buf, sizeof(buf), stream->f)) {
+        size_t len = strlen(buf);
+        while (len > 0 && (buf[len-1] == '\n' || buf[len-1] == '\r'))
+            buf[--len] = '\0';
+        if (len == 0) continue;
+
+        char *line = strdup(buf);
+        pthread_mutex_lock(&stream->lock);
+        while (stream->count == URL_QUEUE_DEPTH && !stream->closed) {
+            pthread_cond_wait(&stream->not_full, &stream->lock);
+        }
+        if (stream->closed) {
+            pthread_mutex_unlock(&stream->lock);
+            free(line);
+            break;
+        }
+        stream->ring[(stream->head + stream->count) % URL_QUEUE_DEPTH] = line;
+        stream->count++;
+        pthread_cond_signal(&stream->not_empty);
+        pthread_mutex_unlock(&stream->lock);
+    }
+
+    pthread_mutex_lock(&stream->lock);
+    stream->eof = true;
+    pthread_cond_broadcast(&stream->not_empty);
+    pthread_mutex_unlock(&stream->lock);
+    return NULL;
+}
+
+url_stream_t *url_stream_open(const char *path) {
+    FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!f) return NULL;
+
+    url_stream_t *stream = calloc(1, sizeof(url_stream_t));
+    stream->f = f;
+    stream->ring = malloc(URL_QUEUE_DEPTH * sizeof(char *));
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->not_empty, NULL);
+    pthread_cond_init(&stream->not_full, NULL);
+
+    if (pthread_create(&stream->reader, NULL, reader_main, stream) != 0) {
+        if (f != stdin) fclose(f);
+        pthread_mutex_destroy(&stream->lock);
+        pthread_cond_destroy(&stream->not_empty);
+        pthread_cond_destroy(&stream->not_full);
+        free(stream->ring);
+        free(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+int url_stream_next(url_stream_t *stream, char **urls, int max, bool fill) {
+    int taken = 0;
+    pthread_mutex_lock(&stream->lock);
+    do {
+        while (stream->count == 0 && !stream->eof) {
+            pthread_cond_wait(&stream->not_empty, &stream->lock);
+        }
+        while (taken < max && stream->count > 0) {
+            urls[taken++] = stream->ring[stream->head];
+            stream->head = (stream->head + 1) % URL_QUEUE_DEPTH;
+            stream->count--;
+        }
+        pthread_cond_signal(&stream->not_full);
+    } while (fill && taken < max && !(stream->eof && stream->count == 0));
+    pthread_mutex_unlock(&stream->lock);
+    return taken;
+}
+
+void url_stream_close(url_stream_t *stream) {
+    if (!stream) return;
+
+    pthread_mutex_lock(&stream->lock);
+    stream->closed = true;
+    pthread_cond_broadcast(&stream->not_full);
+    pthread_mutex_unlock(&stream->lock);
+    pthread_join(stream->reader, NULL);
+
+    for (int i = 0; i < stream->count; i++) {
+        free(stream->ring[(stream->head + i) % URL_QUEUE_DEPTH]);
+    }
+    if (stream->f != stdin) fclose(stream->f);
+    pthread_mutex_destroy(&stream->lock);
+    pthread_cond_destroy(&stream->not_empty);
+    pthread_cond_destroy(&stream->not_full);
+    free(stream->ring);
+    free(stream);
+}
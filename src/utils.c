@@ -73,8 +73,148 @@ char *inject_payload(const char *url, const char *payload) {
     return result;
 }
 
+bool payload_pruned(const config_t *config, int url_idx, int payload_idx) {
+    if (!shard_owns(config, url_idx, payload_idx)) return true;
+    if (checkpoint_done(config, url_idx, payload_idx)) return true;
+    if (!config->url_blocked) return false;
+    return (config->payload_needs[payload_idx] & config->url_blocked[url_idx]) != 0;
+}
+
+int batch_span(const config_t *config, int url_idx, int start, int limit) {
+    if (config->batch <= 1) return 1;
+
+    size_t len = strlen(config->urls[url_idx]);
+    int count = 0;
+    while (start + count < limit && count < config->batch) {
+        const char *payload = config->payloads[start + count];
+        if (strpbrk(payload, "&#")) break;
+        if (payload_pruned(config, url_idx, start + count) || class_settled(config, url_idx, start + count)) break;
+
+        len += BATCH_TAG_LEN + strlen(payload);
+        if (len >= MAX_URL_LEN) break;
+        count++;
+    }
+    return count > 0 ? count : 1;
+}
+
+char *inject_batch(const char *url, char **payloads, int count) {
+    size_t len = 0;
+    for (int i = 0; i < count; i++) len += BATCH_TAG_LEN + strlen(payloads[i]);
+
+    char *joined = malloc(len + 1);
+    char *p = joined;
+    for (int i = 0; i < count; i++) {
+        size_t pay_len = strlen(payloads[i]);
+        p += sprintf(p, BATCH_TAG, i);
+        memcpy(p, payloads[i], pay_len);
+        p += pay_len;
+    }
+    *p = '\0';
+
+    char *result = inject_payload(url, joined);
+    free(joined);
+    return result;
+}
+
 bool check_xss_reflection(const char *response, const char *payload) {
     (void)response;
     (void)payload;
     return false;
 }
+
+const char *ci_find(const char *haystack, size_t h_len, const char *needle, size_t n_len) {
+    if (n_len == 0 || n_len > h_len) return NULL;
+
+    int first = tolower((unsigned char)needle[0]);
+    for (size_t i = 0; i + n_len <= h_len; i++) {
+        if (tolower((unsigned char)haystack[i]) != first) continue;
+
+        size_t j = 1;
+        while (j < n_len && tolower((unsigned char)haystack[i + j]) == tolower((unsigned char)needle[j])) j++;
+        if (j == n_len) return haystack + i;
+    }
+    return NULL;
+}
+
+uint64_t response_fingerprint(const char *body, size_t len, int payload_idx) {
+    return hash64(body, len) ^ ((uint64_t)(payload_idx + 1) * 0x9e3779b97f4a7c15ULL);
+}
+
+uint64_t hash64(const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void json_write_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; s && *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fprintf(f, "\\%c", *s);
+        } else if ((unsigned char)*s < 0x20) {
+            fprintf(f, "\\u%04x", (unsigned char)*s);
+        } else {
+            fputc(*s, f);
+        }
+    }
+    fputc('"', f);
+}
+
+bool url_host_key(const char *url, char *key, size_t len) {
+    CURLU *h = curl_url();
+    if (!h) return false;
+
+    char *scheme = NULL, *host = NULL, *port = NULL;
+    bool ok = curl_url_set(h, CURLUPART_URL, url, CURLU_NON_SUPPORT_SCHEME | CURLU_ALLOW_SPACE) == CURLUE_OK &&
+              curl_url_get(h, CURLUPART_SCHEME, &scheme, 0) == CURLUE_OK &&
+              curl_url_get(h, CURLUPART_HOST, &host, 0) == CURLUE_OK &&
+              curl_url_get(h, CURLUPART_PORT, &port, CURLU_DEFAULT_PORT) == CURLUE_OK;
+
+    if (ok) {
+        for (char *c = host; *c; c++) *c = tolower((unsigned char)*c);
+        ok = snprintf(key, len, "%s://%s:%s", scheme, host, port) < (int)len;
+    }
+
+    curl_free(scheme);
+    curl_free(host);
+    curl_free(port);
+    curl_url_cleanup(h);
+    return ok;
+}
+
+bool url_point_key(const char *url, char *key, size_t len) {
+    char host[MAX_URL_LEN];
+    if (!url_host_key(url, host, sizeof(host))) return false;
+
+    const char *path = strstr(url, "://");
+    path = path ? strchr(path + 3, '/') : NULL;
+    if (!path) path = "/";
+
+    size_t path_len = strcspn(path, "?#");
+    const char *query = path[path_len] == '?' ? path + path_len + 1 : "";
+    size_t query_len = strcspn(query, "#");
+
+    const char *param = query;
+    for (size_t i = 0; i < query_len; i++) {
+        if (query[i] == '&') param = query + i + 1;
+    }
+    size_t param_len = strcspn(param, "=&#");
+
+    return snprintf(key, len, "%s%.*s?%.*s", host, (int)path_len, path, (int)param_len, param) < (int)len;
+}
+
+long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
+}
@@ -0,0 +1,263 @@
+#include "xssmap.h"
+#include <stdarg.h>
+
+typedef enum {
+    MSG_TEXT,
+    MSG_FINDING,
+    MSG_SYNC,
+} writer_kind_t;
+
+typedef struct writer_msg {
+    struct writer_msg *_Atomic next;
+    writer_kind_t kind;
+    char *text;
+    char *record;
+    int url_idx;
+    int payload_idx;
+    bool restored;
+    atomic_bool *synced;
+} writer_msg_t;
+
+struct writer {
+    writer_msg_t *_Atomic head;
+    writer_msg_t *tail;
+    writer_msg_t stub;
+    atomic_bool stopping;
+    pthread_t thread;
+    config_t *config;
+    FILE *out;
+    bool jsonl;
+    long written;
+};
+
+static void push(writer_t *writer, writer_msg_t *msg) {
+    atomic_store_explicit(&msg->next, NULL, memory_order_relaxed);
+    writer_msg_t *prev = atomic_exchange_explicit(&writer->head, msg, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, msg, memory_order_release);
+}
+
+static writer_msg_t *pop(writer_t *writer) {
+    writer_msg_t *tail = writer->tail;
+    writer_msg_t *next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+    if (tail == &writer->stub) {
+        if (!next) return NULL;
+        writer->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&next->next, memory_order_acquire);
+    }
+    if (next) {
+        writer->tail = next;
+        return tail;
+    }
+    if (tail != atomic_load_explicit(&writer->head, memory_order_acquire)) return NULL;
+
+    push(writer, &writer->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (!next) return NULL;
+    writer->tail = next;
+    return tail;
+}
+
+static void json_string(FILE *f, const char *key, const char *s, bool comma) {
+    fprintf(f, "%s\"%s\":", comma ? "," : "", key);
+    json_write_string(f, s);
+}
+
+static void journal_finding(config_t *config, const char *record, int url_idx, int payload_idx) {
+    checkpoint_log(config, record);
+    checkpoint_mark(config, url_idx, payload_idx);
+}
+
+static void write_finding(writer_t *writer, const writer_msg_t *msg) {
+    if (!msg->restored) {
+        printf("\033[32m[✓]\033[0m %s\n", msg->text);
+        journal_finding(writer->config, msg->record, msg->url_idx, msg->payload_idx);
+    }
+    if (!writer->out) return;
+
+    writer->written++;
+    fprintf(writer->out, "%s\n", writer->jsonl ? msg->record : msg->text);
+}
+
+char *finding_record(const finding_t *finding) {
+    char *record = NULL;
+    size_t len = 0;
+    FILE *f = open_memstream(&record, &len);
+    if (!f) return NULL;
+
+    fputc('{', f);
+    json_string(f, "url", finding->url, false);
+    json_string(f, "payload", finding->payload, true);
+    json_string(f, "context", context_name(finding->context), true);
+    json_string(f, "reason", finding->reason, true);
+    fprintf(f, ",\"confidence\":%d,\"status\":%ld,\"total_ms\":%.2f,\"ttfb_ms\":%.2f}",
+            finding->confidence, finding->status, finding->total_ms, finding->ttfb_ms);
+    fclose(f);
+    return record;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool finding_url(const char *record, char *url, size_t len) {
+    const char *key = "{\"url\":\"";
+    if (strncmp(record, key, strlen(key)) != 0) return false;
+
+    size_t n = 0;
+    for (const char *p = record + strlen(key); *p && n + 1 < len; p++) {
+        if (*p == '"') {
+            url[n] = '\0';
+            return true;
+        }
+        if (*p != '\\') {
+            url[n++] = *p;
+            continue;
+        }
+        p++;
+        if (*p == 'u') {
+            int hi = hex_digit(p[3]), lo = hex_digit(p[4]);
+            if (p[1] != '0' || p[2] != '0' || hi < 0 || lo < 0) return false;
+            url[n++] = (char)(hi * 16 + lo);
+            p += 4;
+        } else if (*p == '"' || *p == '\\') {
+            url[n++] = *p;
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
+
+static void flush_all(writer_t *writer) {
+    fflush(stdout);
+    if (writer->out) fflush(writer->out);
+}
+
+static void *writer_main(void *arg) {
+    writer_t *writer = (writer_t *)arg;
+
+    for (;;) {
+        bool stopping = atomic_load(&writer->stopping);
+        int handled = 0;
+        writer_msg_t *msg;
+        while ((msg = pop(writer))) {
+            if (msg->kind == MSG_FINDING) {
+                write_finding(writer, msg);
+            } else if (msg->kind == MSG_SYNC) {
+                atomic_store(msg->synced, true);
+            } else {
+                fputs(msg->text, stdout);
+            }
+            free(msg->text);
+            free(msg->record);
+            free(msg);
+            if (++handled % WRITER_BATCH == 0) flush_all(writer);
+        }
+        if (handled > 0) flush_all(writer);
+        if (stopping) break;
+
+        struct timespec ts = {0, WRITER_IDLE_MS * 1000000L};
+        nanosleep(&ts, NULL);
+    }
+    return NULL;
+}
+
+bool writer_start(config_t *config) {
+    writer_t *writer = calloc(1, sizeof(writer_t));
+    atomic_store(&writer->head, &writer->stub);
+    writer->tail = &writer->stub;
+    writer->config = config;
+    writer->jsonl = config->jsonl;
+
+    if (config->output_file) {
+        writer->out = fopen(config->output_file, "w");
+        if (!writer->out) {
+            fprintf(stderr, "\033[91m[✗]\033[0m failed to open %s\n", config->output_file);
+            free(writer);
+            return false;
+        }
+    }
+    if (pthread_create(&writer->thread, NULL, writer_main, writer) != 0) {
+        if (writer->out) fclose(writer->out);
+        free(writer);
+        return false;
+    }
+    config->writer = writer;
+    return true;
+}
+
+void writer_text(config_t *config, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    if (!config->writer) {
+        vprintf(fmt, ap);
+        va_end(ap);
+        return;
+    }
+
+    va_list copy;
+    va_copy(copy, ap);
+    int len = vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
+    if (len < 0) {
+        va_end(ap);
+        return;
+    }
+
+    writer_msg_t *msg = calloc(1, sizeof(writer_msg_t));
+    msg->kind = MSG_TEXT;
+    msg->text = malloc(len + 1);
+    vsnprintf(msg->text, len + 1, fmt, ap);
+    va_end(ap);
+    push(config->writer, msg);
+}
+
+void writer_finding(config_t *config, const char *url, char *record, int url_idx, int payload_idx, bool restored) {
+    if (!config->writer) {
+        if (!restored) {
+            printf("\033[32m[✓]\033[0m %s\n", url);
+            journal_finding(config, record, url_idx, payload_idx);
+        }
+        free(record);
+        return;
+    }
+
+    writer_msg_t *msg = calloc(1, sizeof(writer_msg_t));
+    msg->kind = MSG_FINDING;
+    msg->text = strdup(url);
+    msg->record = record;
+    msg->url_idx = url_idx;
+    msg->payload_idx = payload_idx;
+    msg->restored = restored;
+    push(config->writer, msg);
+}
+
+void writer_sync(config_t *config) {
+    if (!config->writer) return;
+
+    atomic_bool synced = false;
+    writer_msg_t *msg = calloc(1, sizeof(writer_msg_t));
+    msg->kind = MSG_SYNC;
+    msg->synced = &synced;
+    push(config->writer, msg);
+
+    struct timespec ts = {0, WRITER_IDLE_MS * 1000000L};
+    while (!atomic_load(&synced)) nanosleep(&ts, NULL);
+}
+
+void writer_stop(config_t *config) {
+    writer_t *writer = config->writer;
+    if (!writer) return;
+
+    atomic_store(&writer->stopping, true);
+    pthread_join(writer->thread, NULL);
+    config->writer = NULL;
+
+    if (writer->out) fclose(writer->out);
+    free(writer);
+}
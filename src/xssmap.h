@@ -5,8 +5,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <curl/curl.h>
+#include "techniques/techniques.h"
 
 #define VERSION "1.0.0"
 #define MAX_URL_LEN 4096
@@ -14,28 +18,337 @@
 #define MAX_RESPONSE_SIZE (1024 * 1024)
 #define DEFAULT_THREADS 10
 #define DEFAULT_TIMEOUT 10
+#define MAX_CONCURRENCY 10000
+#define DEFAULT_H2_STREAMS 100
+#define DNS_CACHE_TIMEOUT 300
+#define STREAM_TAIL 256
+#define STREAM_ABORT_MIN (32 * 1024)
+#define BUFFER_MIN_CAPACITY (16 * 1024)
+#define BUFFER_KEEP_MAX (256 * 1024)
+#define BUFFER_HINTS 64
+#define AIMD_INITIAL_WINDOW 2.0
+#define AIMD_LATENCY_SLACK 1.5
+#define AIMD_LATENCY_FLOOR_MS 5.0
+#define AIMD_BACKOFF 0.5
+#define DEFAULT_RETRIES 2
+#define RETRY_BASE_MS 250
+#define RETRY_MAX_MS 5000
+#define DEFAULT_BREAKER 5
+#define BREAKER_COOLDOWN_MS 10000
+#define BREAKER_POLL_MS 50
+#define MAX_BATCH 32
+#define BATCH_TAG_LEN 5
+#define BATCH_TAG_PREFIX "xsb"
+#define BATCH_TAG BATCH_TAG_PREFIX "%02d"
+#define PREFLIGHT_CANARY_LEN 12
+#define PREFLIGHT_MAX_WORKERS 100
+#define PROBE_TOKENS 6
+#define CLASS_BLOCK_STRIKES 3
+#define FINGERPRINT_CACHE 64
+#define SCHEDULE_RUN 32
+#define URL_QUEUE_DEPTH 4096
+#define DEFAULT_URL_WINDOW 1024
+#define URL_WINDOWS 2
+#define FOUND_SET_POINTS 65536
+#define FOUND_EPOCH_BITS 24
+#define HOST_TABLE_MAX 65536
+#define TIMING_SUB_BITS 3
+#define TIMING_BUCKETS (37 << TIMING_SUB_BITS)
+#define HISTORY_CONTEXTS (CTX_CDATA + 1)
+#define HISTORY_PRIOR_WEIGHT 2.0
+#define WRITER_BATCH 64
+#define WRITER_IDLE_MS 2
+#define DETECT_QUEUE_DEPTH 128
+
+typedef struct {
+    int url_idx;
+    int chunk;
+} schedule_entry_t;
+
+typedef struct {
+    long *tries;
+    long *hits;
+    atomic_long *run_tries;
+    atomic_long *run_hits;
+    int *canonical;
+    char **extra;
+    int extra_count;
+    long past_tries;
+    long past_hits;
+    int moved;
+} history_t;
+
+typedef struct url_stream url_stream_t;
+typedef struct window_feed window_feed_t;
+typedef struct task_range task_range_t;
+typedef struct multi_engine multi_engine_t;
+typedef struct journal journal_t;
+typedef struct writer writer_t;
+typedef struct detect_pool detect_pool_t;
+typedef struct detect_inbox detect_inbox_t;
+
+typedef struct {
+    const char *url;
+    const char *payload;
+    const char *reason;
+    html_context_t context;
+    int confidence;
+    long status;
+    double total_ms;
+    double ttfb_ms;
+} finding_t;
 
 typedef struct {
     char **urls;
     int url_count;
+    int url_slots;
+    url_stream_t *url_stream;
+    int url_window;
+    window_feed_t *feed;
+    int *url_origin;
+    char *checkpoint_file;
+    bool resume;
+    journal_t *journal;
     char **payloads;
     int payload_count;
     int threads;
     int timeout;
     bool verbose;
+    bool keepalive;
+    bool compression;
+    int concurrency;
+    bool http2;
+    int h2_streams;
+    size_t stream_window;
+    bool adaptive;
+    int host_cap;
+    int retries;
+    int breaker;
+    int batch;
+    bool preflight;
+    bool probe;
+    unsigned *url_blocked;
+    unsigned *payload_needs;
+    int *payload_class;
+    int class_count;
+    bool classes;
+    atomic_uchar *class_state;
+    bool dedup;
+    bool first_hit;
+    uint64_t *url_point;
+    atomic_uint_least64_t *found_set;
+    size_t found_slots;
+    atomic_long found_points;
+    atomic_long found_epoch;
+    int host_groups;
+    char *stats_file;
+    history_t *history;
+    bool timings;
+    char *timings_file;
+    int shard_index;
+    int shard_count;
+    uint64_t *url_hash;
+    uint64_t *payload_hash;
     char *output_file;
+    bool jsonl;
+    writer_t *writer;
+    int detect_threads;
+    detect_pool_t *detect;
 } config_t;
 
-typedef struct {
+typedef struct buffer_pool buffer_pool_t;
+typedef struct host host_t;
+
+typedef enum {
+    STREAM_UNDECIDED,
+    STREAM_CONFIRMED,
+    STREAM_CLEAN,
+    STREAM_UNREFLECTED
+} stream_verdict_t;
+
+typedef struct response {
     char *data;
     size_t size;
+    size_t capacity;
+    buffer_pool_t *pool;
+    struct response *next;
+    uint64_t hint_key;
+    CURL *curl;
+    const char *payload;
+    size_t payload_len;
+    size_t window;
+    size_t scanned;
+    size_t reflected_at;
+    size_t checked;
+    bool reflected;
+    bool aborted;
+    bool truncated;
+    stream_verdict_t verdict;
+    bool resolved;
+    int tls_reused;
+    detection_result_t det;
 } response_t;
 
+typedef struct detect_job {
+    struct detect_job *next;
+    detect_inbox_t *inbox;
+    response_t *resp;
+    char *test_url;
+    host_t *host;
+    int url_idx;
+    int payload_idx;
+    int batch;
+    long status;
+    long total_us;
+    long ttfb_us;
+    long detect_us;
+    int dedup;
+    bool found;
+    uint32_t candidates;
+    detection_result_t det;
+} detect_job_t;
+
+typedef enum {
+    PHASE_DNS,
+    PHASE_CONNECT,
+    PHASE_TLS,
+    PHASE_TTFB,
+    PHASE_TRANSFER,
+    PHASE_DETECT,
+    PHASE_TOTAL,
+    PHASE_COUNT,
+} timing_phase_t;
+
+typedef struct {
+    long count;
+    long sum;
+    long buckets[TIMING_BUCKETS];
+} latency_hist_t;
+
+typedef struct {
+    long requests;
+    long connects;
+    long reused;
+    long h2_responses;
+    long dns_hits;
+    long dns_misses;
+    long tls_resumed;
+    long tls_full;
+    long stream_hits;
+    long stream_misses;
+    long long bytes_saved;
+    long buffer_allocs;
+    long retries;
+    long long wire_bytes;
+    long long decoded_bytes;
+    long truncated;
+    latency_hist_t timing[PHASE_COUNT];
+} http_stats_t;
+
+struct buffer_pool {
+    response_t *free_list;
+    uint64_t hint_keys[BUFFER_HINTS];
+    size_t hint_sizes[BUFFER_HINTS];
+    http_stats_t *stats;
+};
+
+typedef enum {
+    HOST_OK,
+    HOST_CONGESTED,
+    HOST_FAILED,
+} host_outcome_t;
+
+typedef enum {
+    BREAKER_CLOSED,
+    BREAKER_OPEN,
+    BREAKER_HALF_OPEN,
+} breaker_state_t;
+
+typedef enum {
+    CLASS_OPEN = 0,
+    CLASS_BLOCKED = CLASS_BLOCK_STRIKES,
+    CLASS_CONFIRMED = 0xff,
+} class_state_t;
+
+struct host {
+    char *key;
+    struct host *next;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    double window;
+    int in_flight;
+    int active;
+    double base_latency;
+    double avg_latency;
+    long last_backoff;
+    long requests;
+    long backoffs;
+    breaker_state_t breaker;
+    int failures;
+    long successes;
+    long open_until;
+    bool probing;
+    long trips;
+    uint64_t fingerprints[FINGERPRINT_CACHE];
+    int fingerprint_count;
+    int fingerprint_next;
+    atomic_long *_Atomic timing;
+    long seen;
+};
+
+typedef struct {
+    long seq;
+    int base;
+    int count;
+    int read;
+    schedule_entry_t *schedule;
+    long schedule_len;
+    host_t **hosts;
+    task_range_t *ranges;
+    long span;
+    pthread_mutex_t lock;
+    long next_task;
+    bool exhausted;
+    int users;
+    atomic_long pending;
+} url_window_t;
+
+typedef struct {
+    CURL *curl;
+    struct curl_slist *headers;
+    const config_t *config;
+    buffer_pool_t pool;
+    http_stats_t stats;
+    CURLcode last_code;
+} http_client_t;
+
 typedef struct {
     int total_scanned;
     int total_found;
-    char **vulnerable_urls;
-    int vulnerable_count;
+    int failed;
+    int skipped;
+    int deferred;
+    int batch_requests;
+    int batch_payloads;
+    int batch_candidates;
+    long urls_read;
+    int windows;
+    long hosts_evicted;
+    int preflight_requests;
+    int preflight_dropped;
+    int probe_pruned_urls;
+    int probe_requests;
+    long pruned;
+    long class_skipped;
+    long first_hit_skipped;
+    long dedup_hits;
+    long dedup_misses;
+    int detect_workers;
+    long detect_jobs;
+    long detect_depth_sum;
+    int detect_depth_max;
+    long detect_stalls;
+    http_stats_t http;
     pthread_mutex_t mutex;
 } scan_result_t;
 
@@ -50,11 +363,155 @@ char **load_file_lines(const char *path, int *count);
 void free_lines(char **lines, int count);
 char *url_encode(const char *str);
 char *inject_payload(const char *url, const char *payload);
+bool payload_pruned(const config_t *config, int url_idx, int payload_idx);
+int batch_span(const config_t *config, int url_idx, int start, int limit);
+char *inject_batch(const char *url, char **payloads, int count);
+uint64_t hash64(const void *data, size_t len);
+void json_write_string(FILE *f, const char *s);
+const char *ci_find(const char *haystack, size_t h_len, const char *needle, size_t n_len);
+uint64_t response_fingerprint(const char *body, size_t len, int payload_idx);
+bool url_host_key(const char *url, char *key, size_t len);
+bool url_point_key(const char *url, char *key, size_t len);
+long monotonic_ms(void);
+long monotonic_us(void);
+
+void hosts_init(void);
+void hosts_cleanup(void);
+host_t *host_lookup(const char *url);
+void hosts_foreach(void (*fn)(host_t *host, void *ctx), void *ctx);
+void hosts_advance(long seq);
+long hosts_trim(long retired);
+void host_acquire(host_t *host, int limit);
+bool host_try_acquire(host_t *host, int limit);
+void host_release(host_t *host, double latency_ms, host_outcome_t outcome);
+bool host_breaker_allow(host_t *host);
+bool host_breaker_open(host_t *host);
+void host_breaker_record(host_t *host, bool failed, int threshold);
+bool host_seen_alive(host_t *host);
+void host_enter(host_t *host, int cap);
+bool host_try_enter(host_t *host, int cap);
+void host_leave(host_t *host);
+bool host_fingerprint_seen(host_t *host, uint64_t fingerprint);
+void host_fingerprint_add(host_t *host, uint64_t fingerprint);
 
-response_t *http_get(const char *url, int timeout);
+bool http_share_init(void);
+void http_share_cleanup(void);
+struct curl_slist *http_default_headers(bool keepalive);
+void http_setup_handle(CURL *curl, struct curl_slist *headers, const config_t *config);
+void buffer_pool_init(buffer_pool_t *pool, http_stats_t *stats);
+void buffer_pool_destroy(buffer_pool_t *pool);
+response_t *http_prepare(CURL *curl, buffer_pool_t *pool, const char *url, const char *payload,
+                         const config_t *config);
+CURLcode http_complete(http_stats_t *stats, CURL *curl, response_t *resp, CURLcode res);
+host_outcome_t http_outcome(CURL *curl, CURLcode res, double *latency_ms);
+bool http_should_retry(CURL *curl, CURLcode res);
+bool http_host_failure(CURL *curl, CURLcode res);
+long http_retry_delay_ms(CURL *curl, int attempt);
+void http_stats_merge(http_stats_t *dst, const http_stats_t *src);
+bool http_client_init(http_client_t *client, const config_t *config);
+void http_client_cleanup(http_client_t *client);
+response_t *http_client_get(http_client_t *client, const char *url, const char *payload);
 void free_response(response_t *resp);
 
 void run_scan(config_t *config);
+
+url_stream_t *url_stream_open(const char *path);
+int url_stream_next(url_stream_t *stream, char **urls, int max, bool fill);
+void url_stream_close(url_stream_t *stream);
+
+void feed_init(config_t *config, long first);
+void feed_free(config_t *config);
+url_window_t *feed_open(config_t *config);
+void feed_publish(config_t *config, url_window_t *window);
+void feed_close(config_t *config);
+void feed_stop(config_t *config);
+bool feed_stopped(config_t *config);
+url_window_t *feed_retire(config_t *config);
+url_window_t *feed_next(config_t *config, long seq, bool wait);
+void window_leave(config_t *config, url_window_t *window);
+url_window_t *window_of(const config_t *config, int url_idx);
+void window_hold(url_window_t *window, int count);
+void window_release(config_t *config, int url_idx, int count);
+
+bool checkpoint_open(config_t *config);
+long checkpoint_consumed(const config_t *config);
+long checkpoint_windows(const config_t *config);
+void checkpoint_restore(config_t *config, scan_result_t *result);
+bool checkpoint_done(const config_t *config, int url_idx, int payload_idx);
+void checkpoint_mark(config_t *config, int url_idx, int payload_idx);
+void checkpoint_skip(config_t *config, int url_idx, int payload_idx, int count);
+void checkpoint_log(config_t *config, const char *record);
+void checkpoint_window_done(config_t *config, const url_window_t *window);
+void checkpoint_close(config_t *config);
+
+void timing_record(latency_hist_t *hist, long us);
+void timing_merge(latency_hist_t *dst, const latency_hist_t *src);
+long timing_percentile(const latency_hist_t *hist, double q);
+void timing_record_transfer(http_stats_t *stats, CURL *curl);
+void timing_record_host(host_t *host, CURL *curl);
+void timing_record_host_phase(host_t *host, timing_phase_t phase, long us);
+void timing_print(const http_stats_t *stats);
+bool timing_write(const char *path, const http_stats_t *stats, long elapsed_ms);
+
+extern const char *probe_tokens[PROBE_TOKENS];
+void payload_classes_init(config_t *config);
+void class_state_init(config_t *config);
+void class_state_reset(config_t *config, const url_window_t *window);
+bool class_settled(const config_t *config, int url_idx, int payload_idx);
+void class_record(config_t *config, int url_idx, int payload_idx, bool found, long status);
+
+void history_load(config_t *config);
+void history_record(config_t *config, int payload_idx, bool found, html_context_t context);
+bool history_save(const config_t *config);
+void history_run_totals(const config_t *config, long *tries, long *hits);
+void history_free(config_t *config);
+const char *context_name(html_context_t context);
+
+bool writer_start(config_t *config);
+void writer_text(config_t *config, const char *fmt, ...);
+char *finding_record(const finding_t *finding);
+bool finding_url(const char *record, char *url, size_t len);
+void writer_finding(config_t *config, const char *url, char *record, int url_idx, int payload_idx, bool restored);
+void writer_sync(config_t *config);
+void writer_stop(config_t *config);
+
+int detect_default_threads(void);
+void detect_start(config_t *config);
+void detect_stop(config_t *config, scan_result_t *result);
+detect_job_t *detect_job_new(CURL *curl, response_t *resp, char *test_url, host_t *host, int url_idx, int payload_idx,
+                             int batch);
+void detect_job_free(detect_job_t *job);
+detect_inbox_t *detect_inbox_new(void);
+void detect_inbox_free(detect_inbox_t *inbox);
+void detect_submit(config_t *config, detect_inbox_t *inbox, detect_job_t *job);
+bool detect_try_submit(config_t *config, detect_inbox_t *inbox, detect_job_t *job);
+bool detect_full(config_t *config);
+detect_job_t *detect_take(detect_inbox_t *inbox, bool wait);
+int detect_pending(detect_inbox_t *inbox);
+
+bool shard_parse(const char *spec, int *index, int *count);
+void shard_init(config_t *config);
+void shard_hash_urls(config_t *config, const url_window_t *window);
+bool shard_owns(const config_t *config, int url_idx, int payload_idx);
+int run_merge(int argc, char *argv[]);
+
+void schedule_init(config_t *config, url_window_t *window);
+long schedule_total(const url_window_t *window);
+bool schedule_task(const config_t *config, const url_window_t *window, long pos, int *url_idx, int *payload_idx,
+                   int *limit);
+
+void found_set_init(config_t *config);
+void found_set_points(config_t *config, const url_window_t *window);
+bool found_set_contains(config_t *config, int url_idx);
+void found_set_insert(config_t *config, int url_idx);
+
+void run_preflight(config_t *config, scan_result_t *result, url_window_t *window);
+void scan_result_merge(scan_result_t *dst, scan_result_t *src);
+multi_engine_t *multi_start(config_t *config, scan_result_t *result);
+void multi_stop(multi_engine_t *engine);
+void scan_detect(config_t *config, detect_job_t *job);
+bool scan_process_response(config_t *config, scan_result_t *result, detect_job_t *job);
+int scan_process_batch(config_t *config, scan_result_t *result, detect_job_t *job, int *confirm);
 bool check_xss_reflection(const char *response, const char *payload);
 
 #endif